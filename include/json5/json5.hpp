@@ -3,6 +3,7 @@
 #include "json5_base.hpp"
 
 #if !defined( JSON5_DO_NOT_USE_STL )
+#include <memory_resource>
 #include <string>
 #include <vector>
 #define _JSON5_MOVE                std::move
@@ -39,7 +40,7 @@ public:
 	// Construct boolean value
 	value( bool val ) noexcept;
 
-	// Construct number value from int (will be converted to double)
+	// Construct number value from int (stored as exact integer)
 	value( int val ) noexcept;
 
 	// Construct number value from double
@@ -60,6 +61,9 @@ public:
 	// Checks, if value stores number. Use 'get_number' or 'try_get_number' for reading.
 	bool is_number() const noexcept;
 
+	// Checks, if value stores number as exact integer (parsed from an integer literal)
+	bool is_integer() const noexcept;
+
 	// Checks, if value stores string. Use 'get_c_str' for reading.
 	bool is_string() const noexcept;
 
@@ -83,6 +87,12 @@ public:
 	template <typename T>
 	T get_number( T defaultValue = 0 ) const noexcept
 	{
+		if ( ( _data & mask_tag ) == type_lazy )
+			return resolved().get_number<T>( defaultValue );
+
+		if ( is_integer() )
+			return is_uint64() ? T( get_uint64() ) : T( get_int64() );
+
 		return is_number() ? T( _double ) : defaultValue;
 	}
 
@@ -93,7 +103,7 @@ public:
 		if ( !is_number() )
 			return false;
 
-		out = T( _double );
+		out = get_number<T>();
 		return true;
 	}
 
@@ -120,7 +130,8 @@ public:
 		return ( T )( _data & mask_payload );
 	}
 
-	// Get location in the original file (line, column & byte offset)
+	// Get location of the root value in the original file (line, column & byte offset), other values are
+	// located through their document (see document::loc)
 	location loc() const noexcept;
 
 	template <typename T>
@@ -148,9 +159,6 @@ protected:
 		uint64_t _data;
 	};
 
-	// Location in source file
-	location _loc = {};
-
 	// clang-format off
 	static constexpr uint64_t mask_nanbits     = 0xFFF0000000000000ull;
 	static constexpr uint64_t mask_type        = 0xFFF7000000000000ull;
@@ -163,6 +171,16 @@ protected:
 	static constexpr uint64_t type_array       = 0xFFF5000000000000ull;
 	static constexpr uint64_t type_object      = 0xFFF6000000000000ull;
 	static constexpr uint64_t type_null        = 0xFFF7000000000000ull;
+
+	// Integers use signaling NaNs, that are never produced by arithmetic (see value( double ))
+	static constexpr uint64_t mask_tag         = 0xFFFF000000000000ull;
+	static constexpr uint64_t type_int         = 0x7FF1000000000000ull; // 48-bit signed integer in payload
+	static constexpr uint64_t type_int64       = 0x7FF2000000000000ull; // pointer to int64_t in document
+	static constexpr uint64_t type_uint64      = 0x7FF3000000000000ull; // pointer to uint64_t in document
+	static constexpr uint64_t type_int64_off   = 0x7FF4000000000000ull; // offset of int64_t while building
+	static constexpr uint64_t type_uint64_off  = 0x7FF5000000000000ull; // offset of uint64_t while building
+	static constexpr uint64_t type_lazy        = 0x7FF6000000000000ull; // pointer to lazy number in document
+	static constexpr uint64_t type_lazy_off    = 0x7FF7000000000000ull; // offset of lazy number while building
 	// clang-format on
 
 	// Stores lower 48bits of uint64 as payload
@@ -171,11 +189,65 @@ protected:
 	// Stores lower 48bits of a pointer as payload
 	void payload( const void *p ) noexcept;
 
+	// Returns converted lazy number, other values are returned unchanged
+	value resolved() const noexcept;
+
+	// Integer accessors, valid only when 'is_integer' is true
+	bool is_uint64() const noexcept;
+	int64_t get_int64() const noexcept;
+	uint64_t get_uint64() const noexcept;
+
 	friend document;
 	friend builder;
 	friend parser;
 };
 
+// Hash of object key used by object index
+uint64_t hash_key( string_view key ) noexcept;
+
+// Number of object index slots following the key-value pairs of an indexed object with 'count' pairs.
+// Indexed objects store their size as integer, each slot stores 24 bits of key hash and pair index + 1.
+size_t object_index_size( size_t count ) noexcept;
+
+// Polymorphic allocator of document strings. Integers and lazy numbers are stored between the strings at 8-byte
+// aligned offsets, so the buffer is requested with that alignment (std::pmr::polymorphic_allocator asks for
+// alignof( T ), which lets e.g. std::pmr::monotonic_buffer_resource return odd addresses).
+template <typename T>
+class string_allocator
+{
+public:
+	using value_type = T;
+
+	string_allocator( std::pmr::memory_resource *resource = std::pmr::get_default_resource() ) noexcept
+		: _resource( resource ) {}
+
+	template <typename U>
+	string_allocator( const string_allocator<U> &other ) noexcept : _resource( other.resource() ) {}
+
+	T *allocate( size_t count )
+	{
+		return static_cast<T *>( _resource->allocate( count * sizeof( T ), alignment ) );
+	}
+
+	void deallocate( T *ptr, size_t count ) noexcept
+	{
+		_resource->deallocate( ptr, count * sizeof( T ), alignment );
+	}
+
+	// Copies use the default resource, like std::pmr::polymorphic_allocator
+	string_allocator select_on_container_copy_construction() const noexcept { return string_allocator(); }
+
+	std::pmr::memory_resource *resource() const noexcept { return _resource; }
+
+	template <typename U>
+	bool operator==( const string_allocator<U> &other ) const noexcept { return *_resource == *other.resource(); }
+
+private:
+	static constexpr size_t alignment = alignof( T ) > alignof( uint64_t ) ? alignof( T ) : alignof( uint64_t );
+
+	std::pmr::memory_resource *_resource = nullptr;
+};
+
 } // namespace json5::detail
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -194,40 +266,83 @@ public:
 	// Construct empty document
 	document();
 
-	// Construct a document copy
+	// Construct empty document allocating values and strings from 'resource' (e.g. a per-request
+	// std::pmr::monotonic_buffer_resource), builders of the document allocate from it too
+	explicit document( std::pmr::memory_resource *resource );
+
+	// Construct a document copy (rebases the pointers of every copied value)
 	document( const document &copy );
 
-	// Construct a document from r-value
+	// Construct a document from r-value (takes over the buffers and the memory resource, never allocates)
 	document( document &&rValue ) noexcept;
 
 	// Construct a document from a c-str
 	document( const char* rValue ) noexcept;
 
-	// Copy data from another document (does a deep copy)
+	// Copy data from another document (does a deep copy, rebasing the pointers of every copied value)
 	document &operator=( const document &copy );
 
-	// Assign data from r-value (does a swap)
-	document &operator=( document &&rValue ) noexcept;
+	// Assign data from r-value. Takes over the buffers, when both documents use the same memory resource,
+	// otherwise the data is copied into this document's resource (not noexcept, as copying may throw)
+	document &operator=( document &&rValue );
 
 	// Add UTF-8 characters to the strings array
 	document &operator+( const char* ch );
 	document &operator+( char ch );
 
+	// Memory resource of values and strings
+	std::pmr::memory_resource *resource() const noexcept;
+
+	// Remove all data, memory of values and strings is kept for the next parse
+	void clear() noexcept;
+
+	// Reserve memory for 'values' values and 'strings' bytes of strings
+	void reserve( size_t values, size_t strings );
+
+	// Number of stored values and bytes of stored strings
+	size_t values_size() const noexcept;
+	size_t strings_size() const noexcept;
+
+	using detail::value::loc;
+
+	// Location of 'v' in the original file. Only documents parsed with 'parser_params::track_locations' store
+	// locations, 'v' has to reference a value inside of this document (e.g. item of array_view, key or value
+	// following object_view::source) or be an object or array of it. Returns invalid location otherwise.
+	location loc( const detail::value &v ) const noexcept;
+
 private:
 	detail::string_offset alloc_string( const char *str, size_t length = size_t( -1 ) );
+	detail::string_offset alloc_int64( uint64_t bits );
+	detail::string_offset alloc_lazy_number( string_view text );
 
 	void reset() noexcept;
 
 	void convert_string_offsets();
 
+	// Converts offsets written by the builder into pointers, returns false (nothing converted), when values
+	// reference strings or numbers outside of this document. Values keep pointers, as they are passed around by
+	// copy and can't resolve offsets on access, so finishing a parse or build is one pass over the values.
+	bool resolve_offsets() noexcept;
+
 	void assign_copy( const document &copy );
-	void assign_rvalue( document &&rValue ) noexcept;
+	void assign_rvalue( document &&rValue );
 	void assign_root( detail::value root ) noexcept;
 
 	const char *strings_data() const noexcept;
 
-	std::vector<uint8_t> _strings;
-	std::vector<detail::value> _values;
+	// Checks, if 'str' points into the source buffer parsed in place
+	bool in_situ_contains( const char *str ) const noexcept;
+
+	std::vector<uint8_t, detail::string_allocator<uint8_t>> _strings;
+	std::pmr::vector<detail::value> _values;
+
+	// Locations of '_values' (same index) and of the root, only filled when tracked by the parser
+	std::pmr::vector<location> _locations;
+	location _loc = {};
+
+	// Source buffer of in place parsing, either owned ('_source') or provided by the user
+	string _source;
+	string_view _inSitu;
 
 	friend detail::value;
 	friend builder;
@@ -258,7 +373,7 @@ public:
 	// Source JSON value (first key value in first key-value pair)
 	const detail::value *source() const noexcept;
 
-	// Location of the source value, returns invalid location for invalid view
+	// Location of the source value, locations are kept by the document (use document::loc with 'source')
 	location loc() const noexcept;
 
 	struct key_value_pair
@@ -276,6 +391,9 @@ public:
 		iterator &operator++() noexcept;
 		key_value_pair operator*() const noexcept;
 
+		// Value of the pair inside of the document (e.g. for document::loc)
+		const detail::value &value() const noexcept;
+
 	private:
 		const detail::value *_pair = nullptr;
 	};
@@ -332,7 +450,7 @@ public:
 	// Source JSON value (first array item)
 	const detail::value *source() const noexcept;
 
-	// Location of the source value, returns invalid location for invalid view
+	// Location of the source value, locations are kept by the document (use document::loc with 'source')
 	location loc() const noexcept;
 
 	using iterator = const detail::value *;
@@ -103,6 +103,7 @@ struct error final
 		wrong_array_size,   // invalid number of array elements
 		invalid_enum,       // invalid enum value or string (conversion failed)
 		could_not_open,     // stream is not open
+		aborted,            // parsing stopped by event handler
 	};
 
 	static constexpr const char *type_string[] =
@@ -110,7 +111,7 @@ struct error final
 		"none", "invalid root", "unexpected end", "syntax error", "invalid literal",
 		"invalid escape sequence", "comma expected", "colon expected", "boolean expected",
 		"number expected", "string expected", "object expected", "array expected",
-		"wrong array size", "invalid enum", "could not open stream",
+		"wrong array size", "invalid enum", "could not open stream", "aborted",
 	};
 
 	int type = none;
@@ -154,6 +155,47 @@ struct writer_params
 //---------------------------------------------------------------------------------------------------------------------
 enum class value_type { null = 0, boolean, number, array, string, object };
 
+//---------------------------------------------------------------------------------------------------------------------
+enum class parser_backend
+{
+	recursive,        // Recursive descent, tokenizes while building the document
+	structural_index, // Indexes all tokens first, then builds the document in a second non-recursive pass
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+struct parser_params
+{
+	// Parsing algorithm
+	parser_backend backend = parser_backend::recursive;
+
+	// Keep floating point numbers as text and convert them on first access (see value::get_number)
+	bool lazy_numbers = false;
+
+	// Build hash index for objects with at least 'index_min_keys' keys, object_view::find uses it
+	// for O(1) lookups instead of comparing every key
+	bool index_objects = false;
+	size_t index_min_keys = 16;
+
+	// Store every distinct object key only once, repeated keys share one string in the document
+	bool intern_keys = false;
+
+	// Store location of every value in the document (see document::loc), values don't carry locations
+	bool track_locations = false;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+struct parallel_params
+{
+	// Number of worker threads (0 = number of hardware threads)
+	unsigned threads = 0;
+
+	// Bytes of input parsed by a worker at once, chunks are extended to the end of a line
+	size_t chunk_size = 1 << 20;
+
+	// Deliver results in input order, otherwise in order of completion
+	bool ordered = true;
+};
+
 } // namespace json5
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -214,4 +256,8 @@ struct false_type { constexpr operator bool() const noexcept { return false; } }
 
 template <typename T> struct enum_table : false_type { };
 
+// Types described by JSON5_CLASS or JSON5_MEMBERS
+template <typename T> constexpr bool is_reflected =
+	requires { class_wrapper<T>::names; } || requires( T &t ) { t.make_named_ref_list(); };
+
 } // namespace json5::detail
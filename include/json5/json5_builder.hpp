@@ -14,8 +14,19 @@ public:
 	detail::value new_string( string_view str );
 	detail::value new_string( detail::string_offset stringOffset );
 
-	void push_object();
-	void push_array();
+	// Integers that don't fit into 48 bits are stored in the document
+	detail::value new_int64( int64_t val );
+	detail::value new_uint64( uint64_t val );
+
+	// Number stored as text, converted on first access
+	detail::value new_lazy_number( string_view text );
+
+	// Children are written to their final position, when their number ('count' key-value pairs or items)
+	// is known in advance. Otherwise (or when more are added) they are moved there by 'pop'. Unused reserved
+	// slots are given back, unless reserved containers were pushed after them, then they stay in the document
+	// unreferenced (e.g. an outer container exceeding 'count', after its children reserved slots too).
+	void push_object( size_t count = 0 );
+	void push_array( size_t count = 0 );
 	detail::value pop();
 
 	template <typename... Args>
@@ -28,6 +39,12 @@ public:
 	detail::value &operator[]( string_view key );
 	detail::value &operator[]( detail::string_offset keyOffset );
 
+	// Build hash index for objects with at least 'minKeys' keys in 'pop' (0 = disabled)
+	void index_objects( size_t minKeys ) noexcept;
+
+	// Store every distinct key added by 'operator[]' only once
+	void intern_keys( bool enable ) noexcept;
+
 protected:
 	void reset() noexcept;
 
@@ -35,15 +52,73 @@ protected:
 	detail::string_offset string_buffer_add( string_view str );
 	void string_buffer_add( char ch );
 	void string_buffer_add_utf8( uint32_t ch );
+	void string_buffer_append( const char *str, size_t length );
+	const char *string_buffer_data( detail::string_offset offset ) const noexcept;
+	void string_buffer_discard( detail::string_offset offset ) noexcept;
+
+	// Strings inside 'inSitu' are referenced by the document instead of being copied, 'source' is kept alive
+	void set_source( string &&source, string_view inSitu );
 
 	bool add_item( detail::value v );
 
 	builder& operator+=( detail::value v );
 
+	// Adds 'v' to the innermost container, 'loc' is stored when locations are tracked (containers store it
+	// in their header too)
+	void add_located( detail::value v, location loc );
+
+	// Location of the root value, after the last container was closed
+	void set_root_location( location loc );
+
+	void push_container( detail::value v, size_t count );
+
+	// Returns slot of the next child of the innermost container
+	detail::value &next_slot();
+
+	// Drops document values (and locations) from 'size' on, e.g. reserved slots that were not used
+	void shrink_values( size_t size );
+
+	// Object index follows 'count' key-value pairs of the object at 'header'
+	bool needs_object_index( size_t count ) const noexcept;
+	void build_object_index( size_t header, size_t count );
+	string_view key_string( detail::value key ) const noexcept;
+
+	// Returns offset of 'key' in the string buffer, adds it when seen for the first time
+	detail::string_offset intern_key( string_view key );
+
+	// Removes interned keys stored at 'offset' or after it
+	void discard_keys( detail::string_offset offset ) noexcept;
+
+	// Builds the document from root array elements left on the stack of 'segments' (builders of other
+	// documents), their value indices and string offsets are shifted to the joined buffers
+	detail::value join_segments( const std::vector<const builder *> &segments, location loc );
+
 	document &_doc;
-	std::vector<detail::value> _stack;
-	std::vector<detail::value> _values;
-	std::vector<size_t> _counts;
+	// Container being built, its children follow the header in the document when slots were reserved for them,
+	// otherwise they are kept at the end of '_values' until the container is closed
+	struct open_container
+	{
+		detail::value v;
+		size_t count = 0;        // Number of children (keys and values)
+		size_t header = 0;       // Index of the header in the document
+		size_t reserved = 0;     // Number of reserved slots
+		size_t reserved_end = 0; // End of the reserved slots and the object index in the document
+	};
+
+	// Allocated from the memory resource of the document
+	std::pmr::vector<open_container> _stack;
+	std::pmr::vector<detail::value> _values;
+	size_t _indexMinKeys = 0;
+
+	// Locations of '_values' and of the values in the document (same index), only filled when tracked
+	std::pmr::vector<location> _locations;
+	bool _trackLocations = false;
+
+	// Interned keys, open addressing table of { hash, offset } pairs (offset 0 marks an empty slot)
+	std::pmr::vector<std::pair<uint64_t, detail::string_offset>> _keys;
+	size_t _keyCount = 0;
+	detail::string_offset _lastKeyOffset = 0;
+	bool _internKeys = false;
 };
 
 } // namespace json5
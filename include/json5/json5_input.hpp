@@ -3,6 +3,7 @@
 #include "json5_builder.hpp"
 
 #include <ctype.h>
+#include <functional>
 
 #if __has_include(<charconv>)
 	#include <charconv>
@@ -14,19 +15,130 @@
 namespace json5 {
 
 // Parse json5::document from string
-error from_string( string_view str, document &doc );
+error from_string( string_view str, document &doc, const parser_params &pp = parser_params() );
+
+// Parse json5::document from writable buffer in place. Strings without escape sequences are not
+// copied, their closing quotes are replaced with '\0' and the document references them inside 'str',
+// so the buffer must outlive the document. The buffer is modified even when parsing fails.
+error from_buffer( char *str, size_t len, document &doc, const parser_params &pp = parser_params() );
+
+// Parse json5::document from string in place, the document takes ownership of the string
+error from_buffer( string &&str, document &doc, const parser_params &pp = parser_params() );
+
+// Receives contents of parsed data in document order (see parse_events), default handlers ignore
+// everything. Returning false from any handler stops parsing with error::aborted.
+class event_handler
+{
+public:
+	virtual ~event_handler() = default;
+
+	virtual bool on_object_begin() { return true; }
+	virtual bool on_object_end() { return true; }
+	virtual bool on_array_begin() { return true; }
+	virtual bool on_array_end() { return true; }
+
+	// Object key, the string is only valid during the call
+	virtual bool on_key( string_view /*key*/ ) { return true; }
+
+	// String value, only valid during the call (may contain '\0' from escape sequences)
+	virtual bool on_string( string_view /*str*/ ) { return true; }
+
+	virtual bool on_number( double /*number*/ ) { return true; }
+
+	// Integer literals, reported through 'on_number' unless overridden
+	virtual bool on_int64( int64_t number ) { return on_number( double( number ) ); }
+	virtual bool on_uint64( uint64_t number ) { return on_number( double( number ) ); }
+
+	virtual bool on_boolean( bool /*value*/ ) { return true; }
+	virtual bool on_null() { return true; }
+};
+
+// Parse string and report its contents to 'handler' without building a document. Memory use does
+// not depend on input size, only the string currently being reported is buffered (the recursive backend
+// is always used, 'parser_params::backend' is ignored).
+error parse_events( string_view str, event_handler &handler, const parser_params &pp = parser_params() );
+
+// Receives a parsed record or its error, the document is only valid during the call. Returning false
+// stops parsing.
+using record_callback = std::function<bool( const document &doc, const error &err )>;
+
+// Statistics of 'parse_lines'
+struct parse_stats
+{
+	size_t records = 0; // Delivered records, including failed ones
+	size_t errors = 0;  // Failed records
+	size_t bytes = 0;   // Parsed input bytes
+	double seconds = 0.0;
+	unsigned threads = 0;
+
+	// Aggregate input throughput
+	double bytes_per_second() const noexcept { return seconds > 0.0 ? double( bytes ) / seconds : 0.0; }
+};
+
+// Parse newline delimited records (see parser::parse_line) of 'str' on multiple threads. Every thread parses
+// chunks of whole lines into its own documents, 'fn' receives the records one call at a time. Locations
+// of documents and errors are relative to 'str'.
+parse_stats parse_lines( string_view str, const record_callback &fn, const parser_params &pp = parser_params(),
+	const parallel_params &par = parallel_params() );
+
+// Parse document with a large root array on multiple threads. A structural pre-scan splits the elements into
+// chunks of about 'par.chunk_size' bytes, chunks are parsed into separate documents and joined into 'doc'.
+// Other and invalid input is parsed on a single thread, the result is always the same as of 'from_string'.
+error from_string_parallel( string_view str, document &doc, const parser_params &pp = parser_params(),
+	const parallel_params &par = parallel_params() );
+
+// Tag selecting in place parsing of a writable buffer (see from_buffer)
+struct in_situ_t { explicit in_situ_t() = default; };
+inline constexpr in_situ_t in_situ { };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 class parser final : builder
 {
 public:
-	parser( document &doc, const char *utf8Str, size_t len = size_t( -1 ) );
+	parser( document &doc, const char *utf8Str, size_t len = size_t( -1 ), const parser_params &pp = parser_params() );
+
+	// Parse writable 'utf8Str' in place (see from_buffer)
+	parser( document &doc, in_situ_t, char *utf8Str, size_t len, const parser_params &pp = parser_params() );
+
+	// Parse 'utf8Str' in place, the document takes ownership of the string
+	parser( document &doc, string &&utf8Str, const parser_params &pp = parser_params() );
+
+	// Report contents of 'utf8Str' to 'handler', 'doc' is only used as scratch buffer for strings
+	parser( document &doc, event_handler &handler, const char *utf8Str, size_t len, const parser_params &pp = parser_params() );
+
+	// Parse input passed in chunks to 'feed' and 'finish' (the backend is ignored)
+	explicit parser( document &doc, const parser_params &pp = parser_params() );
+	parser( document &doc, event_handler &handler, const parser_params &pp = parser_params() );
 
 	error parse();
 
+	// Parse 'str' with the same parser, its buffers are reused. With a reused document (see document::clear)
+	// parsing allocates only when the input needs more memory than before.
+	error parse( string_view str );
+
+	friend parse_stats parse_lines( string_view str, const record_callback &fn, const parser_params &pp,
+		const parallel_params &par );
+	friend error from_string_parallel( string_view str, document &doc, const parser_params &pp,
+		const parallel_params &par );
+
+	// Parse next record of newline delimited input (NDJSON, JSON5 lines) into the document, returns false
+	// when there are no more records. The document keeps its memory between records. Anything except whitespace
+	// and comments following the record on its line is a syntax error. Error locations are relative to the whole
+	// input.
+	bool parse_line( error &err );
+
+	// Parse next chunk of input, parsing is suspended inside of a token at the end of the chunk. Only the
+	// incomplete token is copied, the chunk can be released after the call. Returns the first error so far.
+	error feed( const char *data, size_t size );
+	error feed( string_view chunk );
+
+	// Parse rest of the fed input, returns same result as 'parse' would for the whole input at once
+	error finish();
+
 private:
 	int next();
+	void advance( size_t count );
 	int peek() const;
 	bool eof() const;
 	error make_error( int type ) const noexcept;
@@ -35,21 +147,91 @@ private:
 	{
 		unknown, identifier, string, number, colon, comma,
 		object_begin, object_end, array_begin, array_end,
-		literal_true, literal_false, literal_null, literal_NaN
+		literal_true, literal_false, literal_null, literal_NaN, literal_Infinity
 	};
 
-	error parse_value( detail::value &result );
+	void begin_parse();
+	error end_parse();
+
+	// Position before a token, parsing is resumed there when the input ends inside of the token
+	struct checkpoint
+	{
+		const char *cursor = nullptr;
+		size_t size = 0;
+		location loc = { };
+		detail::string_offset strings = 0;
+	};
+
+	error parse_indexed();
+	void count_children();
+	error parse_steps();
+	bool can_continue() const noexcept;
+	error suspend( const checkpoint &cp, error err );
+	error peek_indexed_token( token_type &result );
+
+	// Parse root array elements following the '[' or ',' at the cursor up to the ',' at 'end' (see
+	// from_string_parallel), elements are left on the builder stack. The last chunk ('end' is null) ends with ']'.
+	error parse_array_chunk( const char *end );
+
+	error parse_value( detail::value &result, location &loc );
 	error parse_object();
 	error parse_array();
 	error peek_next_token( token_type &result );
-	error parse_number( double &result );
-	error parse_string( detail::string_offset &result );
-	error parse_identifier( detail::string_offset &result );
+	error parse_number( detail::value &result );
+	error parse_string( detail::value &result );
+	error parse_identifier( detail::value &result );
 	error parse_literal( token_type &result );
 
+	// Build the document or report to the event handler, when set
+	error begin_container( bool isObject, size_t count = 0 );
+	error end_container( bool isObject, detail::value &result );
+	error emit_key( const detail::value &key );
+	error emit_value( const detail::value &v );
+
 	const char *_cursor = nullptr;
 	size_t _size = 0;
 	location _loc = { };
+	parser_params _params;
+
+	// Receives parsed contents instead of the document (see parse_events)
+	event_handler *_handler = nullptr;
+
+	// Source buffer when parsing in place, strings without escapes are terminated inside it
+	char *_writable = nullptr;
+	string _source;
+
+	// Token offsets for parser_backend::structural_index
+	std::vector<uint32_t> _index;
+	size_t _indexPos = 0;
+	size_t _indexStart = 0;
+
+	// Number of items (key-value pairs) of every indexed container in order of their opening brackets
+	std::vector<size_t> _childCounts;
+	std::vector<std::pair<size_t, size_t>> _openBrackets;
+	size_t _containerPos = 0;
+
+	// Non-recursive parsing state (see parse_steps), kept between 'feed' calls
+	struct frame
+	{
+		bool isObject = false;
+		bool expectComma = false;
+		location loc = { };
+		detail::value key = { };
+		location keyLoc = { };
+	};
+
+	enum class step_state { value, object_item, array_item, done };
+
+	std::vector<frame> _frames;
+	step_state _state = step_state::value;
+
+	// Incremental parsing, '_carry' holds an incomplete token from the previous chunk
+	bool _feeding = false;
+	bool _final = true;
+	bool _suspended = false;
+	string _carry;
+	size_t _carryTarget = 0;
+	error _error;
 };
 
 } // namespace json5
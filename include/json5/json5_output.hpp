@@ -3,24 +3,173 @@
 #include "json5.hpp"
 
 #include <cinttypes>
+#include <cstdio>
+#include <functional>
+
+#if __has_include(<charconv>)
+	#include <charconv>
+	#if !defined(_JSON5_HAS_CHARCONV)
+		#define _JSON5_HAS_CHARCONV
+	#endif
+#endif
+
+#if __has_include(<unistd.h>)
+	#if !defined(_JSON5_HAS_UNISTD)
+		#define _JSON5_HAS_UNISTD
+	#endif
+#endif
 
 namespace json5 {
 
-// Converts json5::document to string
+// Receives written output in pieces. Characters are collected in a buffer, that is passed to 'flush' when it
+// is full and by 'finish'. Once 'flush' fails, further output is discarded.
+class output_sink
+{
+public:
+	virtual ~output_sink() = default;
+
+	output_sink( const output_sink & ) = delete;
+	output_sink &operator=( const output_sink & ) = delete;
+
+	void write( const char *str, size_t length )
+	{
+		if ( size_t( _end - _cursor ) < length )
+			return write_slow( str, length );
+
+		memcpy( _cursor, str, length );
+		_cursor += length;
+	}
+
+	void write( string_view str ) { write( str.data(), str.size() ); }
+
+	void write( char ch )
+	{
+		if ( _cursor == _end )
+			return write_slow( &ch, 1 );
+
+		*_cursor++ = ch;
+	}
+
+	// Passes buffered characters to the destination, returns false when writing failed
+	bool finish();
+
+	// True, when the destination failed to receive output
+	bool failed() const noexcept;
+
+protected:
+	output_sink( char *buffer, size_t size ) noexcept;
+
+	// Writes 'length' characters at 'data' to the destination, returns false on failure
+	virtual bool flush( const char *data, size_t length ) = 0;
+
+private:
+	void write_slow( const char *str, size_t length );
+	void flush_buffer();
+
+	char *_buffer = nullptr;
+	char *_cursor = nullptr;
+	char *_end = nullptr;
+	bool _failed = false;
+};
+
+// Sink with 64 KiB buffer
+class buffered_sink : public output_sink
+{
+protected:
+	buffered_sink() noexcept;
+
+private:
+	char _storage[65536];
+};
+
+// Appends output to string
+class string_sink final : public buffered_sink
+{
+public:
+	explicit string_sink( string &str ) noexcept;
+
+protected:
+	bool flush( const char *data, size_t length ) override;
+
+private:
+	string &_str;
+};
+
+// Writes output to C stream
+class file_sink final : public buffered_sink
+{
+public:
+	explicit file_sink( FILE *file ) noexcept;
+
+protected:
+	bool flush( const char *data, size_t length ) override;
+
+private:
+	FILE *_file = nullptr;
+};
+
+#if defined(_JSON5_HAS_UNISTD)
+// Writes output to file descriptor using 'write'
+class fd_sink final : public buffered_sink
+{
+public:
+	explicit fd_sink( int fd ) noexcept;
+
+protected:
+	bool flush( const char *data, size_t length ) override;
+
+private:
+	int _fd = -1;
+};
+#endif
+
+// Passes output to 'fn' in pieces, returning false from 'fn' stops writing
+class callback_sink final : public buffered_sink
+{
+public:
+	explicit callback_sink( std::function<bool( const char *data, size_t length )> fn ) noexcept;
+
+protected:
+	bool flush( const char *data, size_t length ) override;
+
+private:
+	std::function<bool( const char *data, size_t length )> _fn;
+};
+
+// Converts json5::document to string (appended to 'str')
 void to_string( string &str, const document &doc, const writer_params &wp = writer_params() );
 
 // Returns json5::document converted to string
 string to_string( const document &doc, const writer_params &wp = writer_params() );
 
+// Writes json5::document into 'sink' without building the whole string, returns false when the sink failed
+bool to_sink( output_sink &sink, const document &doc, const writer_params &wp = writer_params() );
+
+// Returns exact number of characters 'to_string' produces for json5::document, nothing is allocated
+size_t measure( const document &doc, const writer_params &wp = writer_params() );
+
+// Writes json5::document into 'buffer' of 'size' characters (no null terminator) without allocating, returns number
+// of written characters or 0, when the output does not fit (contents of 'buffer' are unspecified then). Use 'measure'
+// to size the buffer.
+size_t to_buffer( char *buffer, size_t size, const document &doc, const writer_params &wp = writer_params() );
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 //---------------------------------------------------------------------------------------------------------------------
-void to_string( string &str, const char *utf8Str, char quotes, bool escapeUnicode );
+void to_string( output_sink &sink, const char *utf8Str, char quotes, bool escapeUnicode );
 
 //---------------------------------------------------------------------------------------------------------------------
-void to_string( string &str, const detail::value &v, const writer_params &wp, int depth );
+// Writes number in its shortest form, that parses back to the same value. NaN and infinities are written as JSON5
+// literals (null, when 'jsonCompatible' is set).
+void to_string_number( output_sink &sink, const detail::value &v, bool jsonCompatible );
 
 //---------------------------------------------------------------------------------------------------------------------
-string to_string( const document &doc, const writer_params &wp );
+void to_string( output_sink &sink, const detail::value &v, const writer_params &wp, int depth );
+
+//---------------------------------------------------------------------------------------------------------------------
+// Same as above, appending to 'str' through a small buffer (cheap for single strings and numbers)
+void to_string( string &str, const char *utf8Str, char quotes, bool escapeUnicode );
+void to_string_number( string &str, const detail::value &v, bool jsonCompatible );
+void to_string( string &str, const detail::value &v, const writer_params &wp, int depth );
 
 } // namespace json5
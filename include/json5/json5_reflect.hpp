@@ -29,7 +29,10 @@ template <typename T> error from_string( string_view str, T &out );
 
 namespace detail {
 
+class reader;
+
 /* Forward declarations */
+template <typename T> error read( const reader &r, const value &in, T &out );
 template <typename T> error read( const value &in, T &out );
 
 class writer final : public builder
@@ -43,6 +46,25 @@ private:
 	writer_params _params;
 };
 
+// Reads values of a document, errors are located by the document (see document::loc). Values have to be
+// referenced inside of the document (e.g. items of array_view, object_view::iterator::value), to be located.
+// Without a document errors are located by value::loc only.
+class reader final
+{
+public:
+	reader() noexcept = default;
+	explicit reader( const document &doc ) noexcept;
+
+	// Error of 'type' at the location of 'in'
+	error make_error( int type, const value &in ) const noexcept;
+
+	// Error of 'type' at the location of the array viewed by 'arr'
+	error make_error( int type, const array_view &arr ) const noexcept;
+
+private:
+	const document *_doc = nullptr;
+};
+
 //---------------------------------------------------------------------------------------------------------------------
 string_view get_name_slice( const char *names, size_t index );
 
@@ -62,7 +84,7 @@ value write( writer &w, const string &in );
 template <typename T>
 inline value write_array( writer &w, const T *in, size_t numItems )
 {
-	w.push_array();
+	w.push_array( numItems );
 	for ( size_t i = 0; i < numItems; ++i )
 		w( in[i] );
 
@@ -82,7 +104,7 @@ inline value write( writer &w, const T( &in )[N] ) { return write_array( w, in,
 template <typename T>
 inline value write_map( writer &w, const T &in )
 {
-	w.push_object();
+	w.push_object( in.size() );
 
 	for ( const auto &[k, v] : in )
 		w[k] = write( w, v );
@@ -178,43 +200,43 @@ inline value write( writer &w, const T &in )
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /* Forward declarations */
-template <typename T> error read( const value &in, T &out );
+template <typename T> error read( const reader &r, const value &in, T &out );
 
 //---------------------------------------------------------------------------------------------------------------------
-error read( const value &in, bool &out );
+error read( const reader &r, const value &in, bool &out );
 
 //---------------------------------------------------------------------------------------------------------------------
 template <typename T>
-inline error read_number( const value &in, T &out )
+inline error read_number( const reader &r, const value &in, T &out )
 {
-	return in.try_get_number( out ) ? error() : error{ error::number_expected, in.loc() };
+	return in.try_get_number( out ) ? error() : r.make_error( error::number_expected, in );
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-error read( const value &in, int &out );
-error read( const value &in, unsigned &out );
-error read( const value &in, float &out );
-error read( const value &in, double &out );
+error read( const reader &r, const value &in, int &out );
+error read( const reader &r, const value &in, unsigned &out );
+error read( const reader &r, const value &in, float &out );
+error read( const reader &r, const value &in, double &out );
 
 //---------------------------------------------------------------------------------------------------------------------
-error read( const value &in, const char *&out );
+error read( const reader &r, const value &in, const char *&out );
 
 //---------------------------------------------------------------------------------------------------------------------
-inline error read( const value &in, string &out );
+error read( const reader &r, const value &in, string &out );
 
 //---------------------------------------------------------------------------------------------------------------------
 template <typename T>
-inline error read_array( const value &in, T *out, size_t numItems )
+inline error read_array( const reader &r, const value &in, T *out, size_t numItems )
 {
 	if ( !in.is_array() )
-		return { error::array_expected, in.loc() };
+		return r.make_error( error::array_expected, in );
 
 	auto arr = json5::array_view( in );
 	if ( arr.size() != numItems )
-		return { error::wrong_array_size, in.loc() };
+		return r.make_error( error::wrong_array_size, in );
 
 	for ( size_t i = 0; i < numItems; ++i )
-		if ( auto err = read( arr[i], out[i] ) )
+		if ( auto err = read( r, arr.begin()[i], out[i] ) )
 			return err;
 
 	return { error::none };
@@ -222,21 +244,21 @@ inline error read_array( const value &in, T *out, size_t numItems )
 
 //---------------------------------------------------------------------------------------------------------------------
 template <typename T, size_t N>
-inline error read( const value &in, T( &out )[N] ) { return read_array( in, out, N ); }
+inline error read( const reader &r, const value &in, T( &out )[N] ) { return read_array( r, in, out, N ); }
 
 //---------------------------------------------------------------------------------------------------------------------
 template <typename T, typename A>
-inline error read( const value &in, std::vector<T, A> &out )
+inline error read( const reader &r, const value &in, std::vector<T, A> &out )
 {
 	if ( !in.is_array() && !in.is_null() )
-		return { error::array_expected, in.loc() };
+		return r.make_error( error::array_expected, in );
 
 	auto arr = json5::array_view( in );
 
 	out.clear();
 	out.reserve( arr.size() );
 	for ( const auto &i : arr )
-		if ( auto err = read( i, out.emplace_back() ) )
+		if ( auto err = read( r, i, out.emplace_back() ) )
 			return err;
 
 	return { error::none };
@@ -244,19 +266,21 @@ inline error read( const value &in, std::vector<T, A> &out )
 
 //---------------------------------------------------------------------------------------------------------------------
 template <typename T>
-inline error read_map( const value &in, T &out )
+inline error read_map( const reader &r, const value &in, T &out )
 {
 	if ( !in.is_object() && !in.is_null() )
-		return { error::object_expected, in.loc() };
+		return r.make_error( error::object_expected, in );
+
+	auto obj = json5::object_view( in );
 
 	out.clear();
-	for ( auto jsKV : json5::object_view( in ) )
+	for ( auto iter = obj.begin(); iter != obj.end(); ++iter )
 	{
 		std::pair<typename T::key_type, typename T::mapped_type> kvp;
 
-		kvp.first = jsKV.first;
+		kvp.first = ( *iter ).first;
 
-		if ( auto err = read( jsKV.second, kvp.second ) )
+		if ( auto err = read( r, iter.value(), kvp.second ) )
 			return err;
 
 		out.emplace( std::move( kvp ) );
@@ -268,31 +292,31 @@ inline error read_map( const value &in, T &out )
 #if !defined( JSON5_DO_NOT_USE_STL )
 //---------------------------------------------------------------------------------------------------------------------
 template <typename T, size_t N>
-inline error read( const value &in, std::array<T, N> &out )
+inline error read( const reader &r, const value &in, std::array<T, N> &out )
 {
-	return read_array( in, out.data(), N );
+	return read_array( r, in, out.data(), N );
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 template <typename K, typename T, typename P, typename A>
-inline error read( const value &in, std::map<K, T, P, A> &out )
+inline error read( const reader &r, const value &in, std::map<K, T, P, A> &out )
 {
-	return read_map( in, out );
+	return read_map( r, in, out );
 }
 
 template <typename K, typename T, typename H, typename EQ, typename A>
-inline error read( const value &in, std::unordered_map<K, T, H, EQ, A> &out )
+inline error read( const reader &r, const value &in, std::unordered_map<K, T, H, EQ, A> &out )
 {
-	return read_map( in, out );
+	return read_map( r, in, out );
 }
 #endif
 
 //---------------------------------------------------------------------------------------------------------------------
 template <typename T>
-inline error read_enum( const value &in, T &out )
+inline error read_enum( const reader &r, const value &in, T &out )
 {
 	if ( !in.is_string() && !in.is_number() )
-		return { error::string_expected, in.loc() };
+		return r.make_error( error::string_expected, in );
 
 	size_t index = 0;
 	const auto *names = enum_table<T>::names;
@@ -319,12 +343,12 @@ inline error read_enum( const value &in, T &out )
 		++index;
 	}
 
-	return { error::invalid_enum, in.loc() };
+	return r.make_error( error::invalid_enum, in );
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 template <size_t Index = 0, typename... Types>
-inline error read( const json5::object_view &obj, json5::detail::named_ref_list<Types...> &t )
+inline error read( const reader &r, const json5::object_view &obj, json5::detail::named_ref_list<Types...> &t )
 {
 	auto &out = t.get( json5::detail::index<Index>() );
 	using Type = _JSON5_DECAY( decltype( out ) );
@@ -338,13 +362,13 @@ inline error read( const json5::object_view &obj, json5::detail::named_ref_list<
 		{
 			if constexpr ( enum_table<Type>() )
 			{
-				if ( auto err = read_enum( ( *iter ).second, out ) )
+				if ( auto err = read_enum( r, iter.value(), out ) )
 					return err;
 			}
 			else
 			{
 				_JSON5_UNDERLYING( Type ) temp = {};
-				if ( auto err = read( ( *iter ).second, temp ) )
+				if ( auto err = read( r, iter.value(), temp ) )
 					return err;
 
 				out = Type( temp );
@@ -352,14 +376,14 @@ inline error read( const json5::object_view &obj, json5::detail::named_ref_list<
 		}
 		else
 		{
-			if ( auto err = read( ( *iter ).second, out ) )
+			if ( auto err = read( r, iter.value(), out ) )
 				return err;
 		}
 	}
 
 	if constexpr ( Index + 1 != sizeof...( Types ) )
 	{
-		if ( auto err = read < Index + 1 > ( obj, t ) )
+		if ( auto err = read < Index + 1 > ( r, obj, t ) )
 			return err;
 	}
 
@@ -368,37 +392,129 @@ inline error read( const json5::object_view &obj, json5::detail::named_ref_list<
 
 //---------------------------------------------------------------------------------------------------------------------
 template <typename T>
-inline error read( const value &in, T &out )
+inline error read( const reader &r, const value &in, T &out )
 {
-	if ( !in.is_object() )
-		return { error::object_expected, in.loc() };
+	if constexpr ( is_reflected<T> )
+	{
+		if ( !in.is_object() )
+			return r.make_error( error::object_expected, in );
+
+		auto namedTuple = class_wrapper<T>::make_named_ref_list( out );
+		return read( r, json5::object_view( in ), namedTuple );
+	}
+	else
+	{
+		// Own types are read by their 'read( const value &in, T &out )' overload, unlocated errors of these are
+		// located at 'in'
+		auto err = read( in, out );
+		if ( err && !err.loc.is_valid() )
+			err.loc = r.make_error( err.type, in ).loc;
 
-	auto namedTuple = class_wrapper<T>::make_named_ref_list( out );
-	return read( json5::object_view( in ), namedTuple );
+		return err;
+	}
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 template <size_t Index = 0, typename Head, typename... Tail>
-inline error read( const json5::array_view &arr, Head &out, Tail &... tail )
+inline error read( const reader &r, const json5::array_view &arr, Head &out, Tail &... tail )
 {
 	if constexpr ( Index == 0 )
 	{
 		if ( !arr.is_valid() )
-			return { error::array_expected, arr.loc() };
+			return r.make_error( error::array_expected, arr );
 
 		if ( arr.size() != ( 1 + sizeof...( Tail ) ) )
-			return { error::wrong_array_size, arr.loc() };
+			return r.make_error( error::wrong_array_size, arr );
 	}
 
-	if ( auto err = read( arr[Index], out ) )
+	if ( auto err = read( r, arr.begin()[Index], out ) )
 		return err;
 
 	if constexpr ( sizeof...( Tail ) > 0 )
-		return read < Index + 1 > ( arr, tail... );
+		return read < Index + 1 > ( r, arr, tail... );
 
 	return { error::none };
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Overload 'read( const value &in, T &out )' to read own types, the overloads below forward to the reader
+// overloads above. Errors of values read without a reader are located by value::loc only.
+
+//---------------------------------------------------------------------------------------------------------------------
+error read( const value &in, bool &out );
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+inline error read_number( const value &in, T &out ) { return read_number( reader(), in, out ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+error read( const value &in, int &out );
+error read( const value &in, unsigned &out );
+error read( const value &in, float &out );
+error read( const value &in, double &out );
+
+//---------------------------------------------------------------------------------------------------------------------
+error read( const value &in, const char *&out );
+
+//---------------------------------------------------------------------------------------------------------------------
+error read( const value &in, string &out );
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+inline error read_array( const value &in, T *out, size_t numItems ) { return read_array( reader(), in, out, numItems ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, size_t N>
+inline error read( const value &in, T( &out )[N] ) { return read_array( reader(), in, out, N ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, typename A>
+inline error read( const value &in, std::vector<T, A> &out ) { return read( reader(), in, out ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+inline error read_map( const value &in, T &out ) { return read_map( reader(), in, out ); }
+
+#if !defined( JSON5_DO_NOT_USE_STL )
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, size_t N>
+inline error read( const value &in, std::array<T, N> &out ) { return read( reader(), in, out ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename K, typename T, typename P, typename A>
+inline error read( const value &in, std::map<K, T, P, A> &out ) { return read( reader(), in, out ); }
+
+template <typename K, typename T, typename H, typename EQ, typename A>
+inline error read( const value &in, std::unordered_map<K, T, H, EQ, A> &out ) { return read( reader(), in, out ); }
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+inline error read_enum( const value &in, T &out ) { return read_enum( reader(), in, out ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename... Types>
+inline error read( const json5::object_view &obj, json5::detail::named_ref_list<Types...> &t )
+{
+	return read( reader(), obj, t );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+inline error read( const value &in, T &out )
+{
+	static_assert( is_reflected<T>, "Type has to be described by JSON5_CLASS or JSON5_MEMBERS, or overload read" );
+	return read( reader(), in, out );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Head, typename... Tail>
+inline error read( const json5::array_view &arr, Head &out, Tail &... tail )
+{
+	return read( reader(), arr, out, tail... );
+}
+
 } // namespace detail
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -438,7 +554,8 @@ inline string to_string( const T &in, const writer_params &wp )
 template <typename T>
 inline error from_document( const document &doc, T &out )
 {
-	return detail::read( doc, out );
+	detail::reader r( doc );
+	return detail::read( r, doc, out );
 }
 
 //---------------------------------------------------------------------------------------------------------------------
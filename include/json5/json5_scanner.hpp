@@ -0,0 +1,144 @@
+#pragma once
+
+#include "json5_base.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if __has_include(<charconv>)
+	#include <charconv>
+	#if !defined(_JSON5_HAS_CHARCONV)
+		#define _JSON5_HAS_CHARCONV
+	#endif
+#endif
+
+#if !defined( JSON5_DO_NOT_USE_SIMD )
+	#if defined( __x86_64__ ) || defined( _M_X64 )
+		#if !defined( _JSON5_HAS_SSE2 )
+			#define _JSON5_HAS_SSE2
+		#endif
+		#if !defined( _JSON5_HAS_AVX2 )
+			#define _JSON5_HAS_AVX2
+		#endif
+	#endif
+#endif
+
+namespace json5::detail {
+
+//---------------------------------------------------------------------------------------------------------------------
+enum char_class : uint8_t
+{
+	cc_invalid,    // anything that can't start a token
+	cc_whitespace, // bytes 1..32
+	cc_structural, // '{', '}', '[', ']', ':', ','
+	cc_quote,      // '"' or '\''
+	cc_comment,    // '/'
+	cc_identifier, // 'a'..'z', 'A'..'Z', '_'
+	cc_number,     // '0'..'9', '.', '+', '-'
+};
+
+// Class of every byte value, used by the parser to dispatch on the first character of a token
+struct char_class_table
+{
+	uint8_t classes[256] = { };
+
+	constexpr char_class_table()
+	{
+		for ( int ch = 1; ch <= 32; ++ch )
+			classes[ch] = cc_whitespace;
+
+		for ( const char *ch = "{}[]:,"; *ch; ++ch )
+			classes[uint8_t( *ch )] = cc_structural;
+
+		for ( int ch = 'a'; ch <= 'z'; ++ch )
+			classes[ch] = classes[ch - 'a' + 'A'] = cc_identifier;
+
+		for ( int ch = '0'; ch <= '9'; ++ch )
+			classes[ch] = cc_number;
+
+		classes['_'] = cc_identifier;
+		classes['.'] = classes['+'] = classes['-'] = cc_number;
+		classes['"'] = classes['\''] = cc_quote;
+		classes['/'] = cc_comment;
+	}
+
+	constexpr char_class operator[]( int ch ) const noexcept { return char_class( classes[uint8_t( ch )] ); }
+};
+
+inline constexpr char_class_table char_classes;
+
+//---------------------------------------------------------------------------------------------------------------------
+struct block_masks
+{
+	uint64_t whitespace = 0; // bytes 1..32
+	uint64_t structural = 0; // '{', '}', '[', ']', ':', ','
+	uint64_t quote      = 0; // '"' or '\''
+	uint64_t comment    = 0; // '/'
+	uint64_t backslash  = 0; // '\\'
+	uint64_t line_break = 0; // '\n'
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+struct scanner final
+{
+	// Classify 64 bytes at 'block' into bit masks, bit N describes byte N
+	block_masks ( *classify )( const char *block ) noexcept = nullptr;
+
+	// Mask of 64 bytes at 'block', that have to be escaped in a quoted string: control characters, quotes, '\\'
+	// and (when 'nonAscii' is set) bytes >= 128
+	uint64_t ( *escapes )( const char *block, bool nonAscii ) noexcept = nullptr;
+
+	// Name of the selected instruction set: "avx2", "sse2" or "scalar"
+	const char *isa = "scalar";
+
+	// Kernels for the best instruction set supported by the running CPU (selected once)
+	static const scanner &get() noexcept;
+};
+
+// Classify up to 64 bytes at 'str', missing bytes are treated as NUL
+block_masks classify( const char *str, size_t size ) noexcept;
+
+// Returns number of leading whitespace bytes in 'str'
+size_t skip_whitespace( const char *str, size_t size ) noexcept;
+
+// Returns number of leading bytes in 'str', that can be copied into a string verbatim (up to the first
+// quote, '\\' or line break)
+size_t scan_string_run( const char *str, size_t size ) noexcept;
+
+// Returns number of leading bytes in 'str', that can be written into a quoted string verbatim (up to the first
+// control character, quote, '\\' or, when 'nonAscii' is set, byte >= 128)
+size_t scan_escape_run( const char *str, size_t size, bool nonAscii ) noexcept;
+
+//---------------------------------------------------------------------------------------------------------------------
+struct number_token
+{
+	enum kind_type : uint8_t
+	{
+		invalid,  // malformed number
+		deferred, // floating point number, conversion was skipped
+		floating, // 'bits' stores double
+		int64,    // 'bits' stores int64_t (negative integer)
+		uint64,   // 'bits' stores uint64_t (non-negative integer)
+	};
+
+	kind_type kind = invalid;
+	uint64_t bits = 0;
+	size_t length = 0; // Number of scanned characters, also set for invalid numbers
+};
+
+// Scans number at 'str': sign, hexadecimal integer, "Infinity", "NaN", leading or trailing decimal point and
+// exponent. Integers are always converted, floating point conversion is skipped when 'convert' is false.
+number_token scan_number( const char *str, size_t size, bool convert = true ) noexcept;
+
+// Stores byte offsets of all tokens in 'str' into 'index': structural characters, opening quotes of strings
+// and first characters of numbers, literals and identifiers. Whitespace, comments and string contents
+// are skipped. Invalid input is not reported here, the offending byte is indexed as a token instead.
+void build_structural_index( const char *str, size_t size, std::vector<uint32_t> &index );
+
+// Splits root array of 'str' into chunks of about 'chunkSize' bytes: stores location of the opening '[' followed by
+// locations of the ',' starting each next chunk into 'splits'. Strings and comments are skipped, tokens are not
+// validated. Returns false, when the root is not an array or it is not closed.
+bool split_root_array( const char *str, size_t size, size_t chunkSize, std::vector<location> &splits );
+
+} // namespace json5::detail
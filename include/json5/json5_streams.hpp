@@ -1,20 +1,41 @@
 #pragma once
 
 #include "json5_input.hpp"
+#include "json5_output.hpp"
 #include "json5_reflect.hpp"
 
 #include <fstream>
 
 namespace json5 {
 
+// Writes output to std::ostream
+class ostream_sink final : public buffered_sink
+{
+public:
+	explicit ostream_sink( std::ostream &os ) noexcept;
+
+protected:
+	bool flush( const char *data, size_t length ) override;
+
+private:
+	std::ostream &_os;
+};
+
+// Write json5::document into stream, returns 'true' on success
+bool to_stream( std::ostream &os, const document &doc, const writer_params &wp = writer_params() );
+
 // Write json5::document into file, returns 'true' on success
 bool to_file( string_view fileName, const document &doc, const writer_params &wp = writer_params() );
 
 // Serialize instance of type 'T' into file
 template <typename T> bool to_file( string_view fileName, const T &in, const writer_params &wp = writer_params() );
 
-// Parse json5::document from file
-error from_file( string_view fileName, document &doc );
+// Parse json5::document from stream, the input is read and parsed in chunks (see parser::feed)
+error from_stream( std::istream &is, document &doc, const parser_params &pp = parser_params() );
+
+// Parse json5::document from file, regular files are memory mapped (unless JSON5_DO_NOT_USE_MMAP is defined),
+// other files are read in chunks
+error from_file( string_view fileName, document &doc, const parser_params &pp = parser_params() );
 
 // Initialize instance of type 'T' from file
 template <typename T> error from_file( string_view fileName, T &out );
@@ -25,15 +46,10 @@ template <typename T> error from_file( string_view fileName, T &out );
 template <typename T>
 inline bool to_file( string_view fileName, const T &in, const writer_params &wp )
 {
-	std::ofstream ofs( string( fileName ).c_str() );
-	if ( !ofs.is_open() )
-		return false;
-
 	document doc;
 	to_document( doc, in, wp );
 
-	ofs << to_string( doc );
-	return true;
+	return to_file( fileName, doc, wp );
 }
 
 //---------------------------------------------------------------------------------------------------------------------
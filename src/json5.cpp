@@ -1,6 +1,12 @@
 
 #include "json5.hpp"
 
+#include "json5_scanner.hpp"
+
+#include <atomic>
+#include <bit>
+#include <cmath>
+
 namespace json5::detail {
 
 /*
@@ -38,14 +44,15 @@ value::value( bool val ) noexcept
 	:	_data( val ? type_true : type_false )
 {}
 
-// Construct number value from int (will be converted to double)
+// Construct number value from int (stored as exact integer)
 value::value( int val ) noexcept
-	:	_double( val )
+	:	_data( type_int | ( uint64_t( int64_t( val ) ) & mask_payload ) )
 {}
 
-// Construct number value from double
+// Construct number value from double. NaNs are stored as the quiet NaN, other NaN
+// bit patterns are reserved for type tags.
 value::value( double val ) noexcept
-	:	_double( val )
+	:	_double( val == val ? val : double( NAN ) )
 {}
 
 // Construct string value from null-terminated string
@@ -55,7 +62,8 @@ value::value( const char *val ) noexcept
 
 // Return value type
 json5::value_type value::type() const noexcept {
-	if ( ( _data & mask_nanbits ) != mask_nanbits )
+	// -Infinity has all NaN bits set, but no type tag
+	if ( _data <= mask_nanbits )
 		return value_type::number;
 
 	if ( ( _data & mask_type ) == type_object )
@@ -82,7 +90,12 @@ bool value::is_boolean() const noexcept {
 
 // Checks, if value stores number. Use 'get_number' or 'try_get_number' for reading.
 bool value::is_number() const noexcept {
-	return ( _data & mask_nanbits ) != mask_nanbits;
+	return _data <= mask_nanbits;
+}
+
+// Checks, if value stores number as exact integer (parsed from an integer literal)
+bool value::is_integer() const noexcept {
+	return ( _data & mask_tag ) >= type_int && ( _data & mask_tag ) <= type_uint64;
 }
 
 // Checks, if value stores string. Use 'get_c_str' for reading.
@@ -132,7 +145,12 @@ bool value::operator==( const value &other ) const noexcept {
 		else if ( t == value_type::boolean )
 			return _data == other._data;
 		else if ( t == value_type::number )
-			return _double == other._double;
+		{
+			if ( is_integer() && other.is_integer() )
+				return is_uint64() == other.is_uint64() && get_int64() == other.get_int64();
+
+			return get_number<double>() == other.get_number<double>();
+		}
 		else if ( t == value_type::string )
 			return string_view( payload<const char *>() ) == string_view( other.payload<const char *>() );
 		else if ( t == value_type::array )
@@ -169,34 +187,114 @@ value value::operator[]( size_t index ) const noexcept {
 	return av[index];
 }
 
-// Get location in the original file (line, column & byte offset)
+// Get location of the root value in the original file (line, column & byte offset)
 location value::loc() const noexcept {
-	return _loc;
+	return is_document() ? static_cast<const document *>( this )->_loc : location();
 }
 
 void value::relink( const class document *prevDoc, class document &doc ) noexcept {
-	if ( ( _data & mask_type ) == type_string )
+	if ( prevDoc )
 	{
-		if ( prevDoc )
-			payload( payload<const char *>() - prevDoc->strings_data() );
-		else
+		// Copy of 'prevDoc', pointers are moved to the same position in the buffers of 'doc'
+		if ( ( _data & mask_type ) == type_string )
 		{
-			if ( auto *str = get_c_str(); str < doc.strings_data() || str >= doc.strings_data() + doc._strings.size() )
-				payload( doc.alloc_string( str ) );
+			if ( prevDoc->in_situ_contains( get_c_str() ) )
+				payload( doc._inSitu.data() + ( get_c_str() - prevDoc->_inSitu.data() ) );
 			else
-				payload( payload<const char *>() - doc.strings_data() );
+				payload( doc.strings_data() + ( get_c_str() - prevDoc->strings_data() ) );
 		}
+		else if ( auto tag = _data & mask_tag; tag == type_int64 || tag == type_uint64 || tag == type_lazy )
+			payload( doc.strings_data() + ( payload<const char *>() - prevDoc->strings_data() ) );
+		else if ( is_object() || is_array() )
+			payload( doc._values.data() + ( payload<const value *>() - prevDoc->_values.data() ) );
+
+		return;
+	}
+
+	if ( ( _data & mask_type ) == type_string )
+	{
+		// Strings parsed in place stay in the source buffer
+		if ( doc.in_situ_contains( get_c_str() ) )
+			return;
+
+		if ( auto *str = get_c_str(); str < doc.strings_data() || str >= doc.strings_data() + doc._strings.size() )
+			payload( doc.alloc_string( str ) );
+		else
+			payload( payload<const char *>() - doc.strings_data() );
 
 		_data &= ~mask_type;
 		_data |= type_string_off;
 	}
-	else if ( is_object() || is_array() )
+	else if ( auto tag = _data & mask_tag; tag == type_int64 || tag == type_uint64 || tag == type_lazy )
 	{
-		if ( prevDoc )
-			payload( payload<const value *>() - prevDoc->_values.data() );
+		auto *ptr = payload<const char *>();
+		auto *strings = doc.strings_data();
+
+		// Numbers referenced from another document are copied, lazy ones converted
+		if ( ptr < strings || ptr >= strings + doc._strings.size() )
+		{
+			if ( tag == type_lazy )
+			{
+				_data = resolved()._data;
+				return;
+			}
+
+			payload( doc.alloc_int64( *payload<const uint64_t *>() ) );
+		}
+		else
+			payload( ptr - strings );
 
+		_data &= ~mask_tag;
+		_data |= ( tag == type_int64 ) ? type_int64_off : ( tag == type_uint64 ) ? type_uint64_off : type_lazy_off;
+	}
+	else if ( is_object() || is_array() )
 		payload( doc._values.data() + payload<uint64_t>() );
+}
+
+value value::resolved() const noexcept {
+	if ( ( _data & mask_tag ) != type_lazy )
+		return *this;
+
+	// Lazy number is stored as { uint64_t bits, uint8_t kind, char text[] }, 'bits' are written once
+	// on first access. Concurrent readers may convert the number at the same time, both store the same result.
+	auto *slot = payload<uint8_t *>();
+	std::atomic_ref<uint64_t> bits( *reinterpret_cast<uint64_t *>( slot ) );
+	std::atomic_ref<uint8_t> kind( slot[sizeof( uint64_t )] );
+
+	auto k = detail::number_token::kind_type( kind.load( std::memory_order_acquire ) );
+	if ( k == detail::number_token::invalid )
+	{
+		const char *text = reinterpret_cast<const char *>( slot + sizeof( uint64_t ) + 1 );
+		auto number = detail::scan_number( text, strlen( text ) );
+
+		bits.store( number.bits, std::memory_order_relaxed );
+		kind.store( number.kind, std::memory_order_release );
+		k = number.kind;
 	}
+
+	value result;
+
+	if ( k == detail::number_token::floating )
+		result._double = std::bit_cast<double>( bits.load( std::memory_order_relaxed ) );
+	else if ( k == detail::number_token::int64 || k == detail::number_token::uint64 )
+		result._data = ( ( k == detail::number_token::int64 ) ? type_int64 : type_uint64 ) | reinterpret_cast<uint64_t>( slot );
+
+	return result;
+}
+
+bool value::is_uint64() const noexcept {
+	return ( _data & mask_tag ) == type_uint64;
+}
+
+int64_t value::get_int64() const noexcept {
+	if ( ( _data & mask_tag ) == type_int )
+		return int64_t( _data << 16 ) >> 16; // Sign extend 48-bit payload
+
+	return int64_t( *payload<const uint64_t *>() );
+}
+
+uint64_t value::get_uint64() const noexcept {
+	return uint64_t( get_int64() );
 }
 
 // Stores lower 48bits of uint64 as payload
@@ -210,6 +308,21 @@ void value::payload( const void *p ) noexcept {
 }
 
 
+// Hash of object key used by object index
+uint64_t hash_key( string_view key ) noexcept {
+	// FNV-1a
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for ( char ch : key )
+		hash = ( hash ^ uint8_t( ch ) ) * 0x100000001B3ull;
+
+	return hash;
+}
+
+// Number of object index slots, at most half of them are used
+size_t object_index_size( size_t count ) noexcept {
+	return std::bit_ceil( count * 2 );
+}
+
 } // namespace json5::detail
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -228,6 +341,16 @@ document::document()
 	reset();
 }
 
+// Construct empty document allocating from 'resource'
+document::document( std::pmr::memory_resource *resource )
+	:	detail::value()
+	,	_strings( resource )
+	,	_values( resource )
+	,	_locations( resource )
+{
+	reset();
+}
+
 // Construct a document copy
 document::document( const document &copy ) 
 	:	detail::value()
@@ -238,6 +361,9 @@ document::document( const document &copy )
 // Construct a document from r-value
 document::document( document&& rValue ) noexcept
 	:	detail::value()
+	,	_strings( rValue._strings.get_allocator() )
+	,	_values( rValue._values.get_allocator() )
+	,	_locations( rValue._locations.get_allocator() )
 {
 	assign_rvalue( _JSON5_FORWARD<document>( rValue ) );
 }
@@ -253,8 +379,8 @@ document& document::operator=( const document &copy ) {
 	return *this;
 }
 
-// Assign data from r-value (does a swap)
-document& document::operator=( document &&rValue ) noexcept {
+// Assign data from r-value (takes over the buffers, when both documents use the same memory resource)
+document& document::operator=( document &&rValue ) {
 	assign_rvalue( _JSON5_FORWARD<document>( rValue ) );
 	return *this;
 }
@@ -274,6 +400,52 @@ document& document::operator+( const char* ch ) {
 }
 
 
+// Memory resource of values and strings
+std::pmr::memory_resource* document::resource() const noexcept {
+	return _values.get_allocator().resource();
+}
+
+
+// Remove all data, keep memory
+void document::clear() noexcept {
+	reset();
+	_loc = location();
+}
+
+// Reserve memory for values and strings
+void document::reserve( size_t values, size_t strings ) {
+	_values.reserve( values );
+	_strings.reserve( strings );
+}
+
+// Number of values, including object index slots
+size_t document::values_size() const noexcept {
+	return _values.size();
+}
+
+// Bytes of strings, strings of in place parsing stay in the source buffer and are not counted
+size_t document::strings_size() const noexcept {
+	return _strings.size();
+}
+
+// Location of a value of this document, containers are also found by their header
+location document::loc( const detail::value &v ) const noexcept {
+	if ( &v == this )
+		return _loc;
+
+	if ( _locations.empty() )
+		return location();
+
+	const detail::value *first = _values.data(), *last = first + _values.size();
+	const detail::value *p = &v;
+
+	if ( ( p < first || p >= last ) && ( v.is_object() || v.is_array() ) )
+		p = v.payload<const detail::value *>();
+
+	return ( p >= first && p < last ) ? _locations[p - first] : location();
+}
+
+
 detail::string_offset document::alloc_string( const char *str, size_t length ) {
 	if ( length == size_t( -1 ) )
 		length = str ? strlen( str ) : 0;
@@ -289,11 +461,34 @@ detail::string_offset document::alloc_string( const char *str, size_t length ) {
 	return result;
 }
 
+detail::string_offset document::alloc_int64( uint64_t bits ) {
+	// Keep integers 8-byte aligned, the buffer itself is allocated with that alignment (see string_allocator)
+	_strings.resize( ( _strings.size() + 7 ) & ~size_t( 7 ) );
+
+	auto result = detail::string_offset( _strings.size() );
+
+	_strings.resize( _strings.size() + sizeof( bits ) );
+	memcpy( _strings.data() + result, &bits, sizeof( bits ) );
+	return result;
+}
+
+detail::string_offset document::alloc_lazy_number( string_view text ) {
+	// { uint64_t bits, uint8_t kind, char text[] }, zero bits and kind mark the number as not converted yet
+	auto result = detail::string_offset( ( _strings.size() + 7 ) & ~size_t( 7 ) );
+
+	_strings.resize( result + sizeof( uint64_t ) + 1 + text.size() + 1 );
+	memcpy( _strings.data() + result + sizeof( uint64_t ) + 1, text.data(), text.size() );
+	return result;
+}
+
 void document::reset() noexcept {
 	_data = value::type_null | value::mask_is_document;
 	_values.clear();
+	_locations.clear();
 	_strings.clear();
 	_strings.push_back( 0 );
+	_source.clear();
+	_inSitu = string_view();
 }
 
 void document::convert_string_offsets() {
@@ -305,35 +500,114 @@ void document::convert_string_offsets() {
 			v._data &= ~mask_type;
 			v._data |= type_string;
 		}
+		else if ( auto tag = v._data & mask_tag; tag == type_int64_off || tag == type_uint64_off || tag == type_lazy_off )
+		{
+			v.payload( strings_data() + v.payload<uint64_t>() );
+			v._data &= ~mask_tag;
+			v._data |= ( tag == type_int64_off ) ? type_int64 : ( tag == type_uint64_off ) ? type_uint64 : type_lazy;
+		}
+	}
+}
+
+bool document::resolve_offsets() noexcept {
+	auto *strings = strings_data();
+	auto *values = _values.data();
+
+	auto *stringsEnd = strings + _strings.size();
+
+	auto resolve = [this, strings, stringsEnd, values]( detail::value &v ) {
+		if ( auto type = v._data & mask_type; type == type_string_off )
+		{
+			v.payload( strings + v.payload<uint64_t>() );
+			v._data = ( v._data & ~mask_type ) | type_string;
+		}
+		else if ( type == type_object || type == type_array )
+			v.payload( values + v.payload<uint64_t>() );
+		else if ( auto tag = v._data & mask_tag; tag == type_int64_off || tag == type_uint64_off || tag == type_lazy_off )
+		{
+			v.payload( strings + v.payload<uint64_t>() );
+			v._data = ( v._data & ~mask_tag ) |
+			          ( ( tag == type_int64_off ) ? type_int64 : ( tag == type_uint64_off ) ? type_uint64 : type_lazy );
+		}
+		else if ( type == type_string || tag == type_int64 || tag == type_uint64 || tag == type_lazy )
+		{
+			// Pointers are fine, as long as they point into this document
+			auto *ptr = v.payload<const char *>();
+			return ( ptr >= strings && ptr < stringsEnd ) || ( type == type_string && in_situ_contains( ptr ) );
+		}
+
+		return true;
+	};
+
+	for ( size_t i = 0, n = _values.size(); i < n; ++i )
+	{
+		if ( !resolve( _values[i] ) )
+		{
+			// Undo converted containers, the generic path expects offsets there
+			for ( size_t j = 0; j < i; ++j )
+			{
+				if ( auto &v = _values[j]; v.is_object() || v.is_array() )
+					v.payload( uint64_t( v.payload<const detail::value *>() - values ) );
+			}
+
+			return false;
+		}
 	}
+
+	return resolve( *this );
 }
 
 void document::assign_copy( const document &copy ) {
 	_data = copy._data;
+	_loc = copy._loc;
 	_strings = copy._strings;
 	_values = copy._values;
+	_locations = copy._locations;
+	_source = copy._source;
+	_inSitu = copy._source.empty() ? copy._inSitu : string_view( _source );
+
+	// Keep the characters on the heap, so that moves don't invalidate strings parsed in place
+	if ( !_source.empty() && _source.capacity() < sizeof( string ) )
+	{
+		_source.reserve( sizeof( string ) );
+		_inSitu = _source;
+	}
 
 	for ( auto &v : _values )
 		v.relink( &copy, *this );
 
 	relink( &copy, *this );
-	convert_string_offsets();
 }
 
-void document::assign_rvalue( document &&rValue ) noexcept {
-	_data = _JSON5_MOVE( rValue._data );
+void document::assign_rvalue( document &&rValue ) {
+	if ( resource() != rValue.resource() )
+	{
+		// Buffers can't be taken over from another memory resource
+		assign_copy( rValue );
+		return;
+	}
+
+	// Buffers are taken over, pointers into them stay valid
+	_data = rValue._data;
+	_loc = rValue._loc;
 	_strings = _JSON5_MOVE( rValue._strings );
 	_values = _JSON5_MOVE( rValue._values );
+	_locations = _JSON5_MOVE( rValue._locations );
+	_source = _JSON5_MOVE( rValue._source );
+	_inSitu = rValue._inSitu;
 
-	for ( auto &v : _values )
-		v.relink( &rValue, *this );
-
-	convert_string_offsets();
+	rValue._data = value::type_null | value::mask_is_document;
+	rValue._inSitu = string_view();
 }
 
 void document::assign_root( detail::value root ) noexcept {
 	_data = root._data | mask_is_document;
 
+	// Offsets written by the builder are converted in a single pass. Strings and numbers referenced from elsewhere
+	// (e.g. string literals) are copied first, this requires the slower path.
+	if ( resolve_offsets() )
+		return;
+
 	for ( auto &v : _values )
 		v.relink( nullptr, *this );
 
@@ -345,6 +619,10 @@ const char* document::strings_data() const noexcept {
 	return reinterpret_cast<const char *>( _strings.data() );
 }
 
+bool document::in_situ_contains( const char *str ) const noexcept {
+	return str >= _inSitu.data() && str < _inSitu.data() + _inSitu.size();
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -395,6 +673,9 @@ object_view::iterator& object_view::iterator::operator++() noexcept {
 object_view::key_value_pair object_view::iterator::operator*() const noexcept {
 	return { _pair[0].get_c_str(), _pair[1] };
 }
+const detail::value &object_view::iterator::value() const noexcept {
+	return _pair[1];
+}
 
 // Get an iterator to the beginning of the object (first key-value pair)
 object_view::iterator object_view::begin() const noexcept {
@@ -408,7 +689,24 @@ object_view::iterator object_view::end() const noexcept {
 
 // Find property value with 'key'. Returns end iterator, when not found.
 object_view::iterator object_view::find( string_view key ) const noexcept {
-	if ( !key.empty() )
+	if ( !key.empty() && _pair && _pair[-1].is_integer() )
+	{
+		// Hash index follows the key-value pairs
+		const detail::value *table = _pair + _count * 2;
+		const size_t mask = detail::object_index_size( _count ) - 1;
+		const uint64_t hash = detail::hash_key( key );
+
+		for ( size_t i = hash & mask; ; i = ( i + 1 ) & mask )
+		{
+			const uint64_t slot = table[i].payload<uint64_t>();
+			if ( !slot )
+				break;
+
+			if ( const auto *pair = _pair + ( ( slot & 0xFFFFFF ) - 1 ) * 2; ( slot >> 24 ) == ( hash >> 40 ) && key == pair->get_c_str() )
+				return { pair };
+		}
+	}
+	else if ( !key.empty() )
 	{
 		for ( auto iter = begin(); iter != end(); ++iter )
 			if ( key == ( *iter ).first )
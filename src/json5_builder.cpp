@@ -7,6 +7,10 @@ namespace json5 {
 
 builder::builder( document &doc )
 	:	_doc( doc )
+	,	_stack( doc.resource() )
+	,	_values( doc.resource() )
+	,	_locations( doc.resource() )
+	,	_keys( doc.resource() )
 {}
 
 const document& builder::doc() const noexcept {
@@ -21,8 +25,26 @@ detail::value builder::new_string( std::string_view str ) {
 	return new_string( string_buffer_add( str ) );
 }
 
+detail::value builder::new_int64( int64_t val ) {
+	if ( val >= -( int64_t( 1 ) << 47 ) && val < ( int64_t( 1 ) << 47 ) )
+		return { value_type::null, detail::value::type_int | ( uint64_t( val ) & detail::value::mask_payload ) };
+
+	return { value_type::null, detail::value::type_int64_off | _doc.alloc_int64( uint64_t( val ) ) };
+}
+
+detail::value builder::new_uint64( uint64_t val ) {
+	if ( val <= uint64_t( INT64_MAX ) )
+		return new_int64( int64_t( val ) );
+
+	return { value_type::null, detail::value::type_uint64_off | _doc.alloc_int64( val ) };
+}
+
+detail::value builder::new_lazy_number( string_view text ) {
+	return { value_type::null, detail::value::type_lazy_off | _doc.alloc_lazy_number( text ) };
+}
+
 detail::value& builder::operator[]( std::string_view key ) {
-	return ( *this )[string_buffer_add( key )];
+	return ( *this )[_internKeys ? intern_key( key ) : string_buffer_add( key )];
 }
 
 
@@ -38,8 +60,8 @@ detail::string_offset builder::string_buffer_offset() const noexcept
 detail::string_offset builder::string_buffer_add( std::string_view str )
 {
 	auto offset = string_buffer_offset();
-	_doc + str.data();
-	_doc._strings.push_back( 0 );
+	string_buffer_append( str.data(), str.size() );
+	string_buffer_add( 0 );
 	return offset;
 }
 
@@ -47,84 +69,191 @@ void builder::string_buffer_add( char ch ) {
 	_doc._strings.push_back( ch );
 }
 
+const char *builder::string_buffer_data( detail::string_offset offset ) const noexcept {
+	return _doc.strings_data() + offset;
+}
+
+void builder::string_buffer_discard( detail::string_offset offset ) noexcept {
+	_doc._strings.resize( offset );
+
+	// Interned keys must not point to the discarded strings
+	if ( _keyCount && _lastKeyOffset >= offset )
+		discard_keys( offset );
+}
+
+void builder::string_buffer_append( const char *str, size_t length ) {
+	_doc._strings.insert( _doc._strings.end(), str, str + length );
+}
+
+void builder::set_source( string &&source, string_view inSitu ) {
+	_doc._source = _JSON5_MOVE( source );
+	_doc._inSitu = inSitu;
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 void builder::string_buffer_add_utf8( uint32_t ch )
 {
 	if ( 0 <= ch && ch <= 0x7f )
 	{
-		_doc + char( ch );
+		string_buffer_add( char( ch ) );
 	}
 	else if ( 0x80 <= ch && ch <= 0x7ff )
 	{
-		_doc + char( 0xc0 | ( ch >> 6 ) );
-		_doc + char( 0x80 | ( ch & 0x3f ) );
+		string_buffer_add( char( 0xc0 | ( ch >> 6 ) ) );
+		string_buffer_add( char( 0x80 | ( ch & 0x3f ) ) );
 	}
 	else if ( 0x800 <= ch && ch <= 0xffff )
 	{
-		_doc + char( 0xe0 | ( ch >> 12 ) );
-		_doc + char( 0x80 | ( ( ch >> 6 ) & 0x3f ) );
-		_doc + char( 0x80 | ( ch & 0x3f ) );
+		string_buffer_add( char( 0xe0 | ( ch >> 12 ) ) );
+		string_buffer_add( char( 0x80 | ( ( ch >> 6 ) & 0x3f ) ) );
+		string_buffer_add( char( 0x80 | ( ch & 0x3f ) ) );
 	}
 	else if ( 0x10000 <= ch && ch <= 0x1fffff )
 	{
-		_doc + char( 0xf0 | ( ch >> 18 ) );
-		_doc + char( 0x80 | ( ( ch >> 12 ) & 0x3f ) );
-		_doc + char( 0x80 | ( ( ch >> 6 ) & 0x3f ) );
-		_doc + char( 0x80 | ( ch & 0x3f ) );
+		string_buffer_add( char( 0xf0 | ( ch >> 18 ) ) );
+		string_buffer_add( char( 0x80 | ( ( ch >> 12 ) & 0x3f ) ) );
+		string_buffer_add( char( 0x80 | ( ( ch >> 6 ) & 0x3f ) ) );
+		string_buffer_add( char( 0x80 | ( ch & 0x3f ) ) );
 	}
 	else if ( 0x200000 <= ch && ch <= 0x3ffffff )
 	{
-		_doc + char( 0xf8 | ( ch >> 24 ) );
-		_doc + char( 0x80 | ( ( ch >> 18 ) & 0x3f ) );
-		_doc + char( 0x80 | ( ( ch >> 12 ) & 0x3f ) );
-		_doc + char( 0x80 | ( ( ch >> 6 ) & 0x3f ) );
-		_doc + char( 0x80 | ( ch & 0x3f ) );
+		string_buffer_add( char( 0xf8 | ( ch >> 24 ) ) );
+		string_buffer_add( char( 0x80 | ( ( ch >> 18 ) & 0x3f ) ) );
+		string_buffer_add( char( 0x80 | ( ( ch >> 12 ) & 0x3f ) ) );
+		string_buffer_add( char( 0x80 | ( ( ch >> 6 ) & 0x3f ) ) );
+		string_buffer_add( char( 0x80 | ( ch & 0x3f ) ) );
 	}
 	else if ( 0x4000000 <= ch && ch <= 0x7fffffff )
 	{
-		_doc + char( 0xfc | ( ch >> 30 ) );
-		_doc + char( 0x80 | ( ( ch >> 24 ) & 0x3f ) );
-		_doc + char( 0x80 | ( ( ch >> 18 ) & 0x3f ) );
-		_doc + char( 0x80 | ( ( ch >> 12 ) & 0x3f ) );
-		_doc + char( 0x80 | ( ( ch >> 6 ) & 0x3f ) );
-		_doc + char( 0x80 | ( ch & 0x3f ) );
+		string_buffer_add( char( 0xfc | ( ch >> 30 ) ) );
+		string_buffer_add( char( 0x80 | ( ( ch >> 24 ) & 0x3f ) ) );
+		string_buffer_add( char( 0x80 | ( ( ch >> 18 ) & 0x3f ) ) );
+		string_buffer_add( char( 0x80 | ( ( ch >> 12 ) & 0x3f ) ) );
+		string_buffer_add( char( 0x80 | ( ( ch >> 6 ) & 0x3f ) ) );
+		string_buffer_add( char( 0x80 | ( ch & 0x3f ) ) );
 	}
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-void builder::push_object()
+void builder::push_object( size_t count )
 {
-	auto v = detail::value( value_type::object, nullptr );
-	_stack.emplace_back( v );
-	_counts.push_back( 0 );
+	push_container( detail::value( value_type::object, nullptr ), count * 2 );
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-void builder::push_array()
+void builder::push_array( size_t count )
 {
-	auto v = detail::value( value_type::array, nullptr );
-	_stack.emplace_back( v );
-	_counts.push_back( 0 );
+	push_container( detail::value( value_type::array, nullptr ), count );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void builder::push_container( detail::value v, size_t count )
+{
+	auto &c = _stack.emplace_back( open_container{ v } );
+
+	if ( count )
+	{
+		// Header and children, followed by the object index when the object gets one
+		c.header = _doc._values.size();
+		c.reserved = count;
+
+		size_t tableSize = ( v.is_object() && needs_object_index( count / 2 ) ) ? detail::object_index_size( count / 2 ) : 0;
+		c.reserved_end = c.header + 1 + count + tableSize;
+		_doc._values.resize( c.reserved_end );
+
+		if ( _trackLocations )
+			_doc._locations.resize( _doc._values.size() );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+detail::value &builder::next_slot()
+{
+	auto &c = _stack.back();
+
+	if ( c.count < c.reserved )
+		return _doc._values[c.header + 1 + c.count++];
+
+	// More children than reserved, the container continues as if nothing was reserved
+	if ( c.reserved )
+	{
+		auto first = _doc._values.begin() + c.header + 1;
+		_values.insert( _values.end(), first, first + c.count );
+		c.reserved = 0;
+
+		if ( _trackLocations )
+		{
+			auto firstLoc = _doc._locations.begin() + c.header + 1;
+			_locations.insert( _locations.end(), firstLoc, firstLoc + c.count );
+		}
+
+		// Reserved slots are given back, when nothing was reserved after them
+		if ( _doc._values.size() == c.reserved_end )
+			shrink_values( c.header );
+	}
+
+	if ( _trackLocations )
+		_locations.emplace_back();
+
+	++c.count;
+	return _values.emplace_back();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void builder::shrink_values( size_t size )
+{
+	_doc._values.resize( size );
+
+	if ( _trackLocations )
+		_doc._locations.resize( size );
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 detail::value builder::pop()
 {
-	auto result = _stack.back();
-	auto count = _counts.back();
+	auto c = _stack.back();
+	auto result = c.v;
+	bool indexed = result.is_object() && needs_object_index( c.count / 2 );
 
-	result.payload( _doc._values.size() );
+	if ( c.reserved )
+	{
+		// Children are in place, the object index was reserved for all pairs only
+		indexed = indexed && c.count == c.reserved;
 
-	_doc._values.push_back( detail::value( double( count ) ) );
+		// Unused slots are given back, when nothing was reserved after them
+		if ( c.count < c.reserved && _doc._values.size() == c.reserved_end )
+			shrink_values( c.header + 1 + c.count );
+	}
+	else
+	{
+		c.header = _doc._values.size();
+		_doc._values.push_back( detail::value() );
 
-	auto startIndex = _values.size() - count;
-	for ( size_t i = startIndex, S = _values.size(); i < S; ++i )
-		_doc._values.push_back( _values[i] );
+		auto first = _values.end() - c.count;
+		_doc._values.insert( _doc._values.end(), first, _values.end() );
+		_values.erase( first, _values.end() );
 
-	_values.resize( _values.size() - count );
+		if ( indexed )
+			_doc._values.resize( _doc._values.size() + detail::object_index_size( c.count / 2 ) );
+
+		if ( _trackLocations )
+		{
+			// Header location is set, when the container is added to its parent
+			auto firstLoc = _locations.end() - c.count;
+			_doc._locations.emplace_back();
+			_doc._locations.insert( _doc._locations.end(), firstLoc, _locations.end() );
+			_locations.erase( firstLoc, _locations.end() );
+			_doc._locations.resize( _doc._values.size() );
+		}
+	}
+
+	_doc._values[c.header] = detail::value( double( c.count ) );
+	result.payload( c.header );
+
+	if ( indexed )
+		build_object_index( c.header, c.count / 2 );
 
 	_stack.pop_back();
-	_counts.pop_back();
 
 	if ( _stack.empty() )
 	{
@@ -135,20 +264,251 @@ detail::value builder::pop()
 	return result;
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+void builder::index_objects( size_t minKeys ) noexcept
+{
+	_indexMinKeys = minKeys;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool builder::needs_object_index( size_t count ) const noexcept
+{
+	return _indexMinKeys && count >= _indexMinKeys && count < ( 1u << 24 );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void builder::build_object_index( size_t header, size_t count )
+{
+	// Size is stored as integer to mark the object as indexed
+	_doc._values[header] = detail::value( int( count * 2 ) );
+
+	auto tableSize = detail::object_index_size( count );
+	auto tableIndex = header + 1 + count * 2;
+	std::fill_n( _doc._values.begin() + tableIndex, tableSize, detail::value( 0 ) );
+
+	// Keys are still offsets into the string buffer, linear probing keeps duplicate keys in order
+	for ( size_t i = 0; i < count; ++i )
+	{
+		auto key = _doc._values[header + 1 + i * 2];
+		auto hash = detail::hash_key( key_string( key ) );
+
+		auto slot = hash & ( tableSize - 1 );
+		while ( _doc._values[tableIndex + slot].payload<uint64_t>() )
+			slot = ( slot + 1 ) & ( tableSize - 1 );
+
+		_doc._values[tableIndex + slot] = detail::value( value_type::null, detail::value::type_int | ( ( hash >> 40 ) << 24 ) | ( i + 1 ) );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void builder::intern_keys( bool enable ) noexcept
+{
+	_internKeys = enable;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+detail::string_offset builder::intern_key( string_view key )
+{
+	// Keep the table at most half full
+	if ( ( _keyCount + 1 ) * 2 > _keys.size() )
+	{
+		decltype( _keys ) keys( _keys.empty() ? 64 : _keys.size() * 2, _keys.get_allocator() );
+
+		for ( const auto &k : _keys )
+		{
+			if ( !k.second )
+				continue;
+
+			auto slot = k.first & ( keys.size() - 1 );
+			while ( keys[slot].second )
+				slot = ( slot + 1 ) & ( keys.size() - 1 );
+
+			keys[slot] = k;
+		}
+
+		_keys.swap( keys );
+	}
+
+	auto hash = detail::hash_key( key );
+	auto slot = hash & ( _keys.size() - 1 );
+
+	for ( ; _keys[slot].second; slot = ( slot + 1 ) & ( _keys.size() - 1 ) )
+	{
+		const char *str = _doc.strings_data() + _keys[slot].second;
+		if ( _keys[slot].first == hash && memcmp( str, key.data(), key.size() ) == 0 && str[key.size()] == 0 )
+			return _keys[slot].second;
+	}
+
+	++_keyCount;
+	_keys[slot] = { hash, string_buffer_add( key ) };
+	_lastKeyOffset = _keys[slot].second;
+	return _keys[slot].second;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void builder::discard_keys( detail::string_offset offset ) noexcept
+{
+	const size_t mask = _keys.size() - 1;
+
+	for ( auto &k : _keys )
+	{
+		if ( k.second && k.second >= offset )
+		{
+			k = { };
+			--_keyCount;
+		}
+	}
+
+	// Remaining keys are moved back along their probe sequences, starting after an empty slot (the table is
+	// at most half full) every key is reinserted behind the keys preceding it
+	size_t start = 0;
+	while ( _keys[start].second )
+		++start;
+
+	_lastKeyOffset = 0;
+
+	for ( size_t i = 1; i <= mask; ++i )
+	{
+		size_t slot = ( start + i ) & mask;
+		if ( !_keys[slot].second )
+			continue;
+
+		auto k = _keys[slot];
+		_keys[slot] = { };
+
+		for ( slot = k.first & mask; _keys[slot].second; slot = ( slot + 1 ) & mask )
+			;
+
+		_keys[slot] = k;
+
+		if ( k.second > _lastKeyOffset )
+			_lastKeyOffset = k.second;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+detail::value builder::join_segments( const std::vector<const builder *> &segments, location loc )
+{
+	reset();
+
+	// Values of every segment follow the root array and its elements, strings of every segment are appended
+	// 8-byte aligned (integers and lazy numbers are stored there)
+	std::vector<std::pair<size_t, size_t>> bases; // { value index, string offset } of each segment
+	size_t elementCount = 0;
+
+	for ( const auto *s : segments )
+		elementCount += s->_values.size();
+
+	size_t valueCount = 1 + elementCount;
+	size_t stringCount = _doc._strings.size();
+
+	for ( const auto *s : segments )
+	{
+		stringCount = ( stringCount + 7 ) & ~size_t( 7 );
+		bases.emplace_back( valueCount, stringCount );
+		valueCount += s->_doc._values.size();
+		stringCount += s->_doc._strings.size();
+	}
+
+	auto shift = []( detail::value v, const std::pair<size_t, size_t> &base ) {
+		auto tag = v._data & detail::value::mask_tag;
+
+		if ( ( v._data & detail::value::mask_type ) == detail::value::type_string_off || tag == detail::value::type_int64_off
+		     || tag == detail::value::type_uint64_off || tag == detail::value::type_lazy_off )
+			v.payload( v.payload<uint64_t>() + base.second );
+		else if ( v.is_object() || v.is_array() )
+			v.payload( v.payload<uint64_t>() + base.first );
+
+		return v;
+	};
+
+	_doc._values.reserve( valueCount );
+	_doc._values.push_back( detail::value( double( elementCount ) ) );
+
+	for ( size_t i = 0; i < segments.size(); ++i )
+		for ( const auto &v : segments[i]->_values )
+			_doc._values.push_back( shift( v, bases[i] ) );
+
+	_doc._strings.resize( stringCount );
+
+	for ( size_t i = 0; i < segments.size(); ++i )
+	{
+		const auto *s = segments[i];
+
+		for ( const auto &v : s->_doc._values )
+			_doc._values.push_back( shift( v, bases[i] ) );
+
+		memcpy( _doc._strings.data() + bases[i].second, s->_doc._strings.data(), s->_doc._strings.size() );
+	}
+
+	// Locations are joined in the same order as values
+	if ( _trackLocations )
+	{
+		_doc._locations.reserve( valueCount );
+		_doc._locations.push_back( loc );
+
+		for ( const auto *s : segments )
+			_doc._locations.insert( _doc._locations.end(), s->_locations.begin(), s->_locations.end() );
+
+		for ( const auto *s : segments )
+			_doc._locations.insert( _doc._locations.end(), s->_doc._locations.begin(), s->_doc._locations.end() );
+	}
+
+	auto result = detail::value( value_type::array, nullptr );
+	result.payload( uint64_t( 0 ) );
+
+	_doc.assign_root( result );
+	_doc._loc = loc;
+	result = _doc;
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+string_view builder::key_string( detail::value key ) const noexcept
+{
+	if ( ( key._data & detail::value::mask_type ) == detail::value::type_string_off )
+		return _doc.strings_data() + key.payload<size_t>();
+
+	return key.get_c_str();
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 builder& builder::operator+=( detail::value v )
 {
-	_values.push_back( v );
-	_counts.back() += 1;
+	next_slot() = v;
 	return *this;
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+void builder::add_located( detail::value v, location loc )
+{
+	next_slot() = v;
+
+	if ( !_trackLocations )
+		return;
+
+	auto &c = _stack.back();
+	( c.reserved ? _doc._locations[c.header + c.count] : _locations.back() ) = loc;
+
+	// Containers are closed already, their payload is the index of the header
+	if ( v.is_object() || v.is_array() )
+		_doc._locations[v.payload<size_t>()] = loc;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void builder::set_root_location( location loc )
+{
+	_doc._loc = loc;
+
+	if ( _trackLocations && ( _doc.is_object() || _doc.is_array() ) )
+		_doc._locations[_doc.payload<const detail::value *>() - _doc._values.data()] = loc;
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 detail::value &builder::operator[]( detail::string_offset keyOffset )
 {
-	_values.push_back( new_string( keyOffset ) );
-	_counts.back() += 2;
-	return _values.emplace_back();
+	next_slot() = new_string( keyOffset );
+	return next_slot();
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -156,8 +516,20 @@ void builder::reset() noexcept
 {
 	_doc._data = detail::value::type_null;
 	_doc._values.clear();
+	_doc._locations.clear();
 	_doc._strings.clear();
 	_doc._strings.push_back( 0 );
+	_doc._source.clear();
+	_doc._inSitu = string_view();
+
+	// Containers left open by a failed parse
+	_stack.clear();
+	_values.clear();
+	_locations.clear();
+
+	_keys.clear();
+	_keyCount = 0;
+	_lastKeyOffset = 0;
 }
 
 } // namespace json5
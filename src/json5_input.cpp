@@ -3,18 +3,215 @@
 #include "json5_input.hpp"
 
 #include "json5_builder.hpp"
+#include "json5_scanner.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <ctype.h>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 
 namespace json5 {
 
 // Parse json5::document from string
-error from_string( string_view str, document &doc )  {
-	parser r( doc, str.data(), str.size() );
+error from_string( string_view str, document &doc, const parser_params &pp )  {
+	parser r( doc, str.data(), str.size(), pp );
 	return r.parse();
 }
 
+// Parse json5::document from writable buffer in place
+error from_buffer( char *str, size_t len, document &doc, const parser_params &pp ) {
+	parser r( doc, in_situ, str, len, pp );
+	return r.parse();
+}
+
+// Parse json5::document from string in place, the document takes ownership of the string
+error from_buffer( string &&str, document &doc, const parser_params &pp ) {
+	parser r( doc, _JSON5_MOVE( str ), pp );
+	return r.parse();
+}
+
+// Parse string and report its contents to 'handler' without building a document
+error parse_events( string_view str, event_handler &handler, const parser_params &pp ) {
+	document scratch;
+	parser r( scratch, handler, str.data(), str.size(), pp );
+	return r.parse();
+}
+
+// Parse newline delimited records of 'str' on multiple threads
+parse_stats parse_lines( string_view str, const record_callback &fn, const parser_params &pp, const parallel_params &par ) {
+	const auto startTime = std::chrono::steady_clock::now();
+
+	// Chunks end after a line break, so records are never split
+	struct chunk
+	{
+		size_t offset = 0;
+		size_t size = 0;
+		unsigned line = 1;
+	};
+
+	std::vector<chunk> chunks;
+	for ( size_t offset = 0, line = 1; offset < str.size(); )
+	{
+		size_t end = std::min( str.size(), offset + std::max( par.chunk_size, size_t( 1 ) ) );
+		if ( const void *eol = memchr( str.data() + end - 1, '\n', str.size() - end + 1 ) )
+			end = static_cast<const char *>( eol ) - str.data() + 1;
+		else
+			end = str.size();
+
+		chunks.push_back( { offset, end - offset, unsigned( line ) } );
+		line += std::count( str.data() + offset, str.data() + end, '\n' );
+		offset = end;
+	}
+
+	parse_stats stats;
+	stats.threads = std::max( 1u, par.threads ? par.threads : std::thread::hardware_concurrency() );
+	stats.threads = unsigned( std::min( size_t( stats.threads ), std::max( chunks.size(), size_t( 1 ) ) ) );
+
+	std::atomic<size_t> nextChunk = 0;
+	std::atomic<bool> stop = false;
+
+	// Guards 'fn' and 'stats', 'delivered' counts chunks delivered in order
+	std::mutex mutex;
+	std::condition_variable turn;
+	size_t delivered = 0;
+
+	auto worker = [&]()
+	{
+		document doc;
+		std::deque<document> records;
+		std::vector<error> errors;
+
+		for ( size_t index = 0; !stop && ( index = nextChunk++ ) < chunks.size(); )
+		{
+			const auto &c = chunks[index];
+			size_t count = 0;
+
+			parser r( doc, str.data() + c.offset, c.size, pp );
+			r._loc = location( c.line, 1, unsigned( c.offset ) );
+
+			for ( error err; !stop && r.parse_line( err ); ++count )
+			{
+				if ( par.ordered )
+				{
+					// Kept until all previous chunks are delivered, copies reuse memory of earlier chunks
+					if ( count == records.size() )
+					{
+						records.emplace_back();
+						errors.emplace_back();
+					}
+
+					records[count] = doc;
+					errors[count] = err;
+				}
+				else
+				{
+					std::lock_guard lock( mutex );
+					stats.records += 1;
+					stats.errors += err ? 1 : 0;
+
+					if ( !stop && !fn( doc, err ) )
+						stop = true;
+				}
+			}
+
+			std::unique_lock lock( mutex );
+			stats.bytes += c.size;
+
+			if ( !par.ordered )
+				continue;
+
+			turn.wait( lock, [&]() { return delivered == index || stop; } );
+
+			for ( size_t i = 0; i < count && !stop; ++i )
+			{
+				stats.records += 1;
+				stats.errors += errors[i] ? 1 : 0;
+
+				if ( !fn( records[i], errors[i] ) )
+					stop = true;
+			}
+
+			delivered += 1;
+			turn.notify_all();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for ( unsigned i = 1; i < stats.threads; ++i )
+		threads.emplace_back( worker );
+
+	worker();
+
+	for ( auto &t : threads )
+		t.join();
+
+	stats.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - startTime ).count();
+	return stats;
+}
+
+// Parse large root array on multiple threads
+error from_string_parallel( string_view str, document &doc, const parser_params &pp, const parallel_params &par ) {
+	unsigned threads = par.threads ? par.threads : std::thread::hardware_concurrency();
+	std::vector<location> splits;
+
+	// Small documents and other roots are parsed at once
+	if ( threads < 2 || str.size() < par.chunk_size * 2
+	     || !detail::split_root_array( str.data(), str.size(), std::max( par.chunk_size, size_t( 1 ) ), splits )
+	     || splits.size() < 2 )
+		return from_string( str, doc, pp );
+
+	// Chunk starts at '[' or ',' and ends at the next chunk, tokens are read past its end same as when parsing
+	// the whole input at once
+	std::vector<document> docs( splits.size() );
+	std::vector<std::unique_ptr<parser>> chunks;
+
+	for ( const auto &loc : splits )
+	{
+		chunks.push_back( std::make_unique<parser>( docs[chunks.size()], str.data() + loc.offset, str.size() - loc.offset, pp ) );
+		chunks.back()->_loc = loc;
+	}
+
+	std::atomic<size_t> nextChunk = 0;
+	std::atomic<bool> failed = false;
+
+	auto worker = [&]()
+	{
+		for ( size_t index = 0; !failed && ( index = nextChunk++ ) < chunks.size(); )
+		{
+			const char *end = ( index + 1 < chunks.size() ) ? str.data() + splits[index + 1].offset : nullptr;
+			if ( chunks[index]->parse_array_chunk( end ) )
+				failed = true;
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for ( unsigned i = 1; i < std::min( size_t( threads ), chunks.size() ); ++i )
+		workers.emplace_back( worker );
+
+	worker();
+
+	for ( auto &t : workers )
+		t.join();
+
+	// Wrong split of invalid input is not detected by the pre-scan, the error is reported as usual
+	if ( failed )
+		return from_string( str, doc, pp );
+
+	std::vector<const builder *> segments;
+	for ( const auto &c : chunks )
+		segments.push_back( c.get() );
+
+	parser r( doc, str.data(), str.size(), pp );
+	r.join_segments( segments, splits.front() );
+	return { error::none };
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 bool parser::eof() const {
@@ -27,32 +224,289 @@ error parser::make_error( int type ) const noexcept {
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 //---------------------------------------------------------------------------------------------------------------------
-parser::parser( document &doc, const char *utf8Str, size_t len )
+parser::parser( document &doc, const char *utf8Str, size_t len, const parser_params &pp )
 	: builder( doc )
 	, _cursor( utf8Str )
+	, _params( pp )
 {
 	if ( _cursor && len == size_t( -1 ) )
 		_size = strlen( _cursor );
 	else
 		_size = len;
+
+	if ( pp.index_objects )
+		index_objects( pp.index_min_keys ? pp.index_min_keys : 1 );
+
+	intern_keys( pp.intern_keys );
+	_trackLocations = pp.track_locations;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+parser::parser( document &doc, in_situ_t, char *utf8Str, size_t len, const parser_params &pp )
+	: parser( doc, utf8Str, len, pp )
+{
+	_writable = utf8Str;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+parser::parser( document &doc, string &&utf8Str, const parser_params &pp )
+	: parser( doc, nullptr, 0, pp )
+{
+	_source = _JSON5_MOVE( utf8Str );
+
+	// Keep the characters on the heap, small strings would move together with the document
+	if ( _source.capacity() < sizeof( string ) )
+		_source.reserve( sizeof( string ) );
+
+	_cursor = _writable = _source.data();
+	_size = _source.size();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+parser::parser( document &doc, const parser_params &pp )
+	: parser( doc, nullptr, 0, pp )
+{
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+parser::parser( document &doc, event_handler &handler, const parser_params &pp )
+	: parser( doc, handler, nullptr, 0, pp )
+{
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+parser::parser( document &doc, event_handler &handler, const char *utf8Str, size_t len, const parser_params &pp )
+	: parser( doc, utf8Str, len, pp )
+{
+	_handler = &handler;
+
+	// Strings are discarded after every event, numbers are always converted
+	_params.lazy_numbers = false;
+	intern_keys( false );
+	_trackLocations = false;
+
+	// Structural index would grow with the input
+	_params.backend = parser_backend::recursive;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 error parser::parse()
+{
+	begin_parse();
+
+	if ( _params.backend == parser_backend::structural_index )
+	{
+		if ( auto err = parse_indexed() )
+			return err;
+	}
+	else
+	{
+		location loc;
+		if ( auto err = parse_value( _doc, loc ) )
+			return err;
+
+		set_root_location( loc );
+	}
+
+	return end_parse();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+error parser::parse( string_view str )
+{
+	_cursor = str.data();
+	_size = str.size();
+	_writable = nullptr;
+	_source.clear();
+
+	return parse();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool parser::parse_line( error &err )
+{
+	if ( _loc.line == 0 && _size )
+		_loc = { 1, 1, 0 };
+
+	// Blank lines and comments between records are skipped
+	if ( token_type tt = token_type::unknown; peek_next_token( tt ) && eof() )
+		return false;
+
+	// Every line is parsed on its own, an error doesn't affect the following records
+	const char *eol = static_cast<const char *>( memchr( _cursor, '\n', _size ) );
+	const char *end = eol ? eol : _cursor + _size;
+	size_t rest = _cursor + _size - end;
+
+	reset();
+
+	// In place parsed strings reference the parser's buffer, it is shared by all records
+	if ( _writable )
+		set_source( string(), string_view( _writable, end + rest - _writable ) );
+
+	_size = end - _cursor;
+
+	if ( _params.backend == parser_backend::structural_index )
+		err = parse_indexed();
+	else
+	{
+		location loc;
+		if ( !( err = parse_value( _doc, loc ) ) )
+			set_root_location( loc );
+	}
+
+	if ( !err )
+		err = end_parse();
+
+	// Only whitespace and comments may follow the record on its line
+	if ( token_type tt = token_type::unknown; !err && ( peek_next_token( tt ), !eof() ) )
+		err = make_error( error::syntax_error );
+
+	// Skip the rest of the line (also after an error)
+	advance( end - _cursor );
+	_size += rest;
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+error parser::feed( const char *data, size_t size )
+{
+	if ( !_feeding )
+	{
+		_cursor = nullptr;
+		_size = 0;
+		begin_parse();
+
+		_index.clear();
+		_childCounts.clear();
+		_frames.clear();
+		_state = step_state::value;
+		_carry.clear();
+		_error = { };
+		_feeding = true;
+		_final = false;
+	}
+
+	if ( size && _loc.line == 0 )
+		_loc = { 1, 1, 0 };
+
+	while ( size && !_error && _state != step_state::done )
+	{
+		bool inCarry = !_carry.empty();
+		size_t count = 0;
+
+		if ( inCarry )
+		{
+			// Incomplete token is parsed again once it has grown enough (see '_carryTarget')
+			count = std::min( size, _carryTarget - _carry.size() );
+			_carry.append( data, count );
+
+			if ( _carry.size() < _carryTarget )
+				break;
+
+			_cursor = _carry.data();
+			_size = _carry.size();
+		}
+		else
+		{
+			_cursor = data;
+			_size = size;
+		}
+
+		_suspended = false;
+		_error = parse_steps();
+
+		if ( !inCarry )
+		{
+			if ( _suspended )
+				_carry.assign( _cursor, _size );
+
+			size = 0;
+		}
+		else
+		{
+			data += count;
+			size -= count;
+
+			if ( !_suspended )
+				_carry.clear();
+			else if ( _size <= count )
+			{
+				// Rest of the input is still in 'data', continue there without copying
+				data -= _size;
+				size += _size;
+				_carry.clear();
+			}
+			else
+				_carry.erase( 0, _cursor - _carry.data() );
+		}
+
+		// Doubling the size before each attempt keeps parsing time linear even for tiny chunks
+		_carryTarget = _carry.size() + std::max( _carry.size(), size_t( 256 ) );
+	}
+
+	return _error;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+error parser::feed( string_view chunk )
+{
+	return feed( chunk.data(), chunk.size() );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+error parser::finish()
+{
+	if ( !_feeding )
+		feed( nullptr, 0 );
+
+	_feeding = false;
+	_final = true;
+
+	if ( !_error && _state != step_state::done )
+	{
+		_cursor = _carry.data();
+		_size = _carry.size();
+		_error = parse_steps();
+	}
+
+	_carry.clear();
+
+	if ( _error )
+		return _error;
+
+	return end_parse();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void parser::begin_parse()
 {
 	reset();
 
+	if ( _writable )
+		set_source( _JSON5_MOVE( _source ), string_view( _writable, _size ) );
+
+	// Estimated from the input size (strings parsed in place are not copied), memory of a reused document
+	// is usually large enough already
+	if ( !_handler )
+		_doc.reserve( _size / 16, _writable ? _size / 16 : _size / 2 );
+
 	_loc = { };
 
 	if ( _cursor && _size )
 		_loc = { 1, 1, 0 };
+}
 
-	if ( auto err = parse_value( _doc ) )
-		return err;
-
+//---------------------------------------------------------------------------------------------------------------------
+error parser::end_parse()
+{
 	if ( !_doc.is_array() && !_doc.is_object() )
 		return make_error( error::invalid_root );
 
+	// Root is only a placeholder when reporting events
+	if ( _handler )
+		reset();
+
 	return { error::none };
 }
 
@@ -76,6 +530,28 @@ int parser::next()
 	return ch;
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+void parser::advance( size_t count )
+{
+	const char *end = _cursor + count;
+	const char *lastLineBreak = nullptr;
+
+	for ( const char *p = _cursor; ( p = static_cast<const char *>( memchr( p, '\n', end - p ) ) ); ++p )
+	{
+		++_loc.line;
+		lastLineBreak = p;
+	}
+
+	if ( lastLineBreak )
+		_loc.column = unsigned( end - lastLineBreak );
+	else
+		_loc.column += unsigned( count );
+
+	_loc.offset += unsigned( count );
+	_cursor = end;
+	_size -= count;
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 int parser::peek() const
 {
@@ -86,31 +562,345 @@ int parser::peek() const
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-error parser::parse_value( detail::value &result )
+error parser::parse_indexed()
+{
+	detail::build_structural_index( _cursor, _size, _index );
+	_indexPos = 0;
+
+	// Every value starts at a token
+	if ( !_handler )
+	{
+		_doc.reserve( _index.size(), 0 );
+		count_children();
+	}
+
+	_indexStart = _loc.offset;
+
+	_frames.clear();
+	_state = step_state::value;
+
+	return parse_steps();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void parser::count_children()
+{
+	_childCounts.clear();
+	_openBrackets.clear();
+	_containerPos = 0;
+
+	// Items are separated by commas, a trailing comma is allowed. Counts of invalid input may be wrong, the
+	// builder handles any number of children.
+	for ( size_t i = 0; i < _index.size(); ++i )
+	{
+		const char ch = _cursor[_index[i]];
+
+		if ( ch == '[' || ch == '{' )
+		{
+			_openBrackets.emplace_back( _childCounts.size(), 0 );
+			_childCounts.push_back( 0 );
+		}
+		else if ( ch == ',' && !_openBrackets.empty() )
+			_openBrackets.back().second += 1;
+		else if ( ( ch == ']' || ch == '}' ) && !_openBrackets.empty() )
+		{
+			const auto [container, commas] = _openBrackets.back();
+			const char prev = _cursor[_index[i - 1]];
+			_openBrackets.pop_back();
+
+			_childCounts[container] = ( prev == '[' || prev == '{' ) ? 0 : ( prev == ',' ) ? commas : commas + 1;
+		}
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+error parser::parse_steps()
+{
+	detail::value result;
+	location loc = { };
+
+	while ( _state != step_state::done )
+	{
+		// Every step starts at a token, it is parsed again when the input ends inside of it
+		const checkpoint cp = { _cursor, _size, _loc, string_buffer_offset() };
+
+		token_type tt = token_type::unknown;
+		if ( auto err = peek_indexed_token( tt ) )
+			return suspend( cp, err );
+
+		// Set when 'result' holds a complete value for the innermost container
+		bool complete = false;
+
+		if ( _state == step_state::value )
+		{
+			loc = _loc;
+
+			switch ( tt )
+			{
+				case token_type::number:
+				{
+					if ( auto err = parse_number( result ) )
+						return suspend( cp, err );
+				}
+				break;
+
+				case token_type::string:
+				{
+					if ( auto err = parse_string( result ) )
+						return suspend( cp, err );
+				}
+				break;
+
+				case token_type::identifier:
+				{
+					if ( token_type lit = token_type::unknown; auto err = parse_literal( lit ) )
+						return suspend( cp, err );
+					else if ( lit == token_type::literal_true )
+						result = detail::value( true );
+					else if ( lit == token_type::literal_false )
+						result = detail::value( false );
+					else if ( lit == token_type::literal_null )
+						result = detail::value();
+					else if ( lit == token_type::literal_NaN )
+						result = detail::value( NAN );
+					else if ( lit == token_type::literal_Infinity )
+						result = detail::value( double( INFINITY ) );
+					else
+						return suspend( cp, make_error( error::invalid_literal ) );
+				}
+				break;
+
+				case token_type::object_begin:
+					next(); // Consume '{'
+					if ( auto err = begin_container( true, _containerPos < _childCounts.size() ? _childCounts[_containerPos++] : 0 ) )
+						return err;
+
+					_frames.push_back( { .isObject = true, .loc = loc } );
+					_state = step_state::object_item;
+					continue;
+
+				case token_type::array_begin:
+					next(); // Consume '['
+					if ( auto err = begin_container( false, _containerPos < _childCounts.size() ? _childCounts[_containerPos++] : 0 ) )
+						return err;
+
+					_frames.push_back( { .isObject = false, .loc = loc } );
+					_state = step_state::array_item;
+					continue;
+
+				default:
+					return make_error( error::syntax_error );
+			}
+
+			// More input could continue a number or literal
+			if ( can_continue() )
+				return suspend( cp, { error::none } );
+
+			complete = true;
+		}
+		else if ( _state == step_state::object_item )
+		{
+			auto &top = _frames.back();
+
+			switch ( tt )
+			{
+				case token_type::identifier:
+				case token_type::string:
+				{
+					if ( top.expectComma )
+						return make_error( error::comma_expected );
+
+					top.keyLoc = _loc;
+					if ( auto err = parse_identifier( top.key ) )
+						return suspend( cp, err );
+
+					if ( auto err = peek_indexed_token( tt ) )
+						return suspend( cp, err );
+
+					if ( tt != token_type::colon )
+						return make_error( error::colon_expected );
+
+					next(); // Consume ':'
+
+					if ( _handler )
+					{
+						if ( auto err = emit_key( top.key ) )
+							return err;
+					}
+
+					_state = step_state::value;
+				}
+				break;
+
+				case token_type::object_end:
+					next(); // Consume '}'
+					complete = true;
+					break;
+
+				case token_type::comma:
+					if ( !top.expectComma )
+						return make_error( error::syntax_error );
+
+					next(); // Consume ','
+					top.expectComma = false;
+					break;
+
+				default:
+					return top.expectComma ? make_error( error::comma_expected ) : make_error( error::syntax_error );
+			}
+		}
+		else if ( _state == step_state::array_item )
+		{
+			auto &top = _frames.back();
+
+			if ( tt == token_type::array_end && next() ) // Consume ']'
+				complete = true;
+			else if ( top.expectComma )
+			{
+				top.expectComma = false;
+
+				if ( tt != token_type::comma )
+					return make_error( error::comma_expected );
+
+				next(); // Consume ','
+			}
+			else
+				_state = step_state::value;
+		}
+
+		if ( !complete )
+			continue;
+
+		// Closing a container, its value belongs to the parent (or becomes the root)
+		if ( _state != step_state::value )
+		{
+			loc = _frames.back().loc;
+			bool isObject = _frames.back().isObject;
+			_frames.pop_back();
+
+			if ( auto err = end_container( isObject, result ) )
+				return err;
+		}
+		else if ( _handler )
+		{
+			if ( auto err = emit_value( result ) )
+				return err;
+		}
+
+		if ( _frames.empty() )
+		{
+			static_cast<detail::value &>( _doc ) = result;
+			set_root_location( loc );
+			_state = step_state::done;
+		}
+		else if ( auto &parent = _frames.back(); parent.isObject )
+		{
+			if ( !_handler )
+			{
+				add_located( parent.key, parent.keyLoc );
+				add_located( result, loc );
+			}
+
+			parent.expectComma = true;
+			_state = step_state::object_item;
+		}
+		else
+		{
+			if ( !_handler )
+				add_located( result, loc );
+
+			parent.expectComma = true;
+			_state = step_state::array_item;
+		}
+	}
+
+	return { error::none };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool parser::can_continue() const noexcept
+{
+	if ( _final )
+		return false;
+
+	// Only characters of a number, literal or identifier remain
+	for ( size_t i = 0; i < _size; ++i )
+	{
+		int ch = uint8_t( _cursor[i] );
+		if ( !isalnum( ch ) && ch != '.' && ch != '_' && ch != '+' && ch != '-' )
+			return false;
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+error parser::suspend( const checkpoint &cp, error err )
+{
+	// Only an error (or a token) at the end of a fed chunk can be fixed by more input
+	if ( !can_continue() )
+		return err;
+
+	_cursor = cp.cursor;
+	_size = cp.size;
+	_loc = cp.loc;
+	string_buffer_discard( cp.strings );
+
+	_suspended = true;
+	return { error::none };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+error parser::peek_indexed_token( token_type &result )
+{
+	// Index offsets are relative to the start of the indexed input
+	const size_t offset = _loc.offset - _indexStart;
+
+	// Skip the token consumed by parse_number, parse_string, ...
+	size_t skipped = 0;
+	for ( ; _indexPos < _index.size() && _index[_indexPos] < offset; ++_indexPos )
+		++skipped;
+
+	// Only whitespace and comments can be between the cursor and the next indexed token
+	bool inSync = skipped <= 1;
+	if ( inSync && _indexPos < _index.size() && _index[_indexPos] != offset )
+	{
+		auto cc = detail::char_classes[peek()];
+		inSync = ( cc == detail::cc_whitespace || cc == detail::cc_comment );
+	}
+
+	// If a token swallowed the next ones (malformed input), the index no longer agrees
+	// with the tokenizer and the rest of the input is scanned instead
+	if ( !inSync )
+		_indexPos = _index.size();
+	else if ( _indexPos < _index.size() )
+		advance( _index[_indexPos] - offset );
+
+	return peek_next_token( result );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+error parser::parse_value( detail::value &result, location &loc )
 {
 	token_type tt = token_type::unknown;
 	if ( auto err = peek_next_token( tt ) )
 		return err;
 
-	location loc = _loc;
+	loc = _loc;
 
 	switch ( tt )
 	{
 		case token_type::number:
 		{
-			if ( double number = 0.0; auto err = parse_number( number ) )
+			if ( auto err = parse_number( result ) )
 				return err;
-			else
-				result = detail::value( number );
 		}
 		break;
 
 		case token_type::string:
 		{
-			if ( detail::string_offset offset = 0; auto err = parse_string( offset ) )
+			if ( auto err = parse_string( result ) )
 				return err;
-			else
-				result = new_string( offset );
 		}
 		break;
 
@@ -128,6 +918,8 @@ error parser::parse_value( detail::value &result )
 					result = detail::value();
 				else if ( lit == token_type::literal_NaN )
 					result = detail::value( NAN );
+				else if ( lit == token_type::literal_Infinity )
+					result = detail::value( double( INFINITY ) );
 				else
 					return make_error( error::invalid_literal );
 			}
@@ -136,23 +928,27 @@ error parser::parse_value( detail::value &result )
 
 		case token_type::object_begin:
 		{
-			push_object();
+			if ( auto err = begin_container( true ) )
+				return err;
 			{
 				if ( auto err = parse_object() )
 					return err;
 			}
-			result = pop();
+			if ( auto err = end_container( true, result ) )
+				return err;
 		}
 		break;
 
 		case token_type::array_begin:
 		{
-			push_array();
+			if ( auto err = begin_container( false ) )
+				return err;
 			{
 				if ( auto err = parse_array() )
 					return err;
 			}
-			result = pop();
+			if ( auto err = end_container( false, result ) )
+				return err;
 		}
 		break;
 
@@ -160,7 +956,12 @@ error parser::parse_value( detail::value &result )
 			return make_error( error::syntax_error );
 	}
 
-	result._loc = loc;
+	if ( _handler && !result.is_object() && !result.is_array() )
+	{
+		if ( auto err = emit_value( result ) )
+			return err;
+	}
+
 	return { error::none };
 }
 
@@ -176,7 +977,7 @@ error parser::parse_object()
 		if ( auto err = peek_next_token( tt ) )
 			return err;
 
-		detail::string_offset keyOffset;
+		detail::value key;
 		location keyLoc = { };
 
 		switch ( tt )
@@ -188,8 +989,14 @@ error parser::parse_object()
 					return make_error( error::comma_expected );
 
 				keyLoc = _loc;
-				if ( auto err = parse_identifier( keyOffset ) )
+				if ( auto err = parse_identifier( key ) )
 					return err;
+
+				if ( _handler )
+				{
+					if ( auto err = emit_key( key ) )
+						return err;
+				}
 			}
 			break;
 
@@ -218,13 +1025,16 @@ error parser::parse_object()
 		next(); // Consume ':'
 
 		detail::value newValue;
-		if ( auto err = parse_value( newValue ) )
+		location loc;
+		if ( auto err = parse_value( newValue, loc ) )
 			return err;
 
-		detail::value key = new_string( keyOffset );
-		key._loc = keyLoc;
+		if ( !_handler )
+		{
+			add_located( key, keyLoc );
+			add_located( newValue, loc );
+		}
 
-		( *this )( key, newValue );
 		expectComma = true;
 	}
 
@@ -257,10 +1067,13 @@ error parser::parse_array()
 		}
 
 		detail::value newValue;
-		if ( auto err = parse_value( newValue ) )
+		location loc;
+		if ( auto err = parse_value( newValue, loc ) )
 			return err;
 
-		add_item( newValue );
+		if ( !_handler )
+			add_located( newValue, loc );
+
 		expectComma = true;
 	}
 
@@ -268,129 +1081,215 @@ error parser::parse_array()
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-error parser::peek_next_token( token_type &result )
+error parser::parse_array_chunk( const char *end )
 {
-	enum class comment_type { none, line, block } parsingComment = comment_type::none;
+	reset();
+	push_array();
+
+	next(); // Consume '[' or ','
 
+	bool expectComma = false;
 	while ( !eof() )
 	{
-		int ch = peek();
-		if ( ch == '\n' )
-		{
-			if ( parsingComment == comment_type::line )
-				parsingComment = comment_type::none;
-		}
-		else if ( parsingComment != comment_type::none || ( ch > 0 && ch <= 32 ) )
+		token_type tt = token_type::unknown;
+		if ( auto err = peek_next_token( tt ) )
+			return err;
+
+		// Chunk ends after an element, at the ',' starting the next chunk
+		if ( end && _cursor >= end )
 		{
-			if ( parsingComment == comment_type::block && ch == '*' && next() ) // Consume '*'
-			{
-				if ( peek() == '/' )
-					parsingComment = comment_type::none;
-			}
+			if ( _cursor == end && tt == token_type::comma && expectComma )
+				return { error::none };
+
+			return make_error( error::syntax_error );
 		}
-		else if ( ch == '/' && next() ) // Consume '/'
+
+		if ( tt == token_type::array_end )
 		{
-			if ( peek() == '/' )
-				parsingComment = comment_type::line;
-			else if ( peek() == '*' )
-				parsingComment = comment_type::block;
-			else
+			if ( end )
 				return make_error( error::syntax_error );
-		}
-		else if ( strchr( "{}[]:,", ch ) )
-		{
-			if ( ch == '{' )
-				result = token_type::object_begin;
-			else if ( ch == '}' )
-				result = token_type::object_end;
-			else if ( ch == '[' )
-				result = token_type::array_begin;
-			else if ( ch == ']' )
-				result = token_type::array_end;
-			else if ( ch == ':' )
-				result = token_type::colon;
-			else if ( ch == ',' )
-				result = token_type::comma;
 
+			next(); // Consume ']'
 			return { error::none };
 		}
-		else if ( isalpha( ch ) || ch == '_' )
-		{
-			result = token_type::identifier;
-			return { error::none };
-		}
-		else if ( isdigit( ch ) || ch == '.' || ch == '+' || ch == '-' )
+		else if ( expectComma )
 		{
-			if ( ch == '+' ) next(); // Consume leading '+'
+			expectComma = false;
 
-			result = token_type::number;
-			return { error::none };
-		}
-		else if ( ch == '"' || ch == '\'' )
-		{
-			result = token_type::string;
-			return { error::none };
+			if ( tt != token_type::comma )
+				return make_error( error::comma_expected );
+
+			next(); // Consume ','
+			continue;
 		}
-		else
-			return make_error( error::syntax_error );
 
-		next();
+		detail::value newValue;
+		location loc;
+		if ( auto err = parse_value( newValue, loc ) )
+			return err;
+
+		add_located( newValue, loc );
+		expectComma = true;
 	}
 
 	return make_error( error::unexpected_end );
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-error parser::parse_number( double &result )
+error parser::peek_next_token( token_type &result )
 {
-	char buff[256] = { };
-	size_t length = 0;
-
-	while ( !eof() && length < sizeof( buff ) )
+	while ( !eof() )
 	{
-		buff[length++] = next();
-
 		int ch = peek();
-		if ( ( ch > 0 && ch <= 32 ) || ch == ',' || ch == '}' || ch == ']' )
-			break;
-	}
 
-#if defined(_JSON5_HAS_CHARCONV)
-	auto convResult = std::from_chars( buff, buff + length, result );
+		switch ( detail::char_classes[ch] )
+		{
+			case detail::cc_whitespace:
+				advance( detail::skip_whitespace( _cursor, _size ) );
+				continue;
 
-	if ( convResult.ec != std::errc() )
-		return make_error( error::syntax_error );
-#else
-	char *buffEnd = nullptr;
-	result = strtod( buff, &buffEnd );
+			case detail::cc_comment:
+			{
+				next(); // Consume '/'
+
+				if ( peek() == '/' )
+				{
+					// Line comment, ends before '\n' (consumed as whitespace)
+					const void *eol = memchr( _cursor, '\n', _size );
+					advance( eol ? static_cast<const char *>( eol ) - _cursor : _size );
+				}
+				else if ( peek() == '*' )
+				{
+					// Block comment, ends after "*/"
+					const char *end = _cursor + 1;
+					while ( ( end = static_cast<const char *>( memchr( end, '*', _cursor + _size - end ) ) ) )
+					{
+						if ( end + 1 < _cursor + _size && end[1] == '/' )
+							break;
+
+						++end;
+					}
+
+					advance( end ? end + 2 - _cursor : _size );
+				}
+				else
+					return make_error( error::syntax_error );
+			}
+			continue;
+
+			case detail::cc_structural:
+			{
+				if ( ch == '{' )
+					result = token_type::object_begin;
+				else if ( ch == '}' )
+					result = token_type::object_end;
+				else if ( ch == '[' )
+					result = token_type::array_begin;
+				else if ( ch == ']' )
+					result = token_type::array_end;
+				else if ( ch == ':' )
+					result = token_type::colon;
+				else if ( ch == ',' )
+					result = token_type::comma;
+			}
+			return { error::none };
 
-	if ( result == 0.0 && buffEnd == buff )
+			case detail::cc_identifier:
+				result = token_type::identifier;
+				return { error::none };
+
+			case detail::cc_number:
+				if ( ch == '+' ) next(); // Consume leading '+'
+
+				result = token_type::number;
+				return { error::none };
+
+			case detail::cc_quote:
+				result = token_type::string;
+				return { error::none };
+
+			default:
+				return make_error( error::syntax_error );
+		}
+	}
+
+	return make_error( error::unexpected_end );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+error parser::parse_number( detail::value &result )
+{
+	auto number = detail::scan_number( _cursor, _size, !_params.lazy_numbers );
+	const char *start = _cursor;
+
+	advance( number.length );
+
+	if ( number.kind == detail::number_token::int64 )
+		result = new_int64( int64_t( number.bits ) );
+	else if ( number.kind == detail::number_token::uint64 )
+		result = new_uint64( number.bits );
+	else if ( number.kind == detail::number_token::floating )
+		result = detail::value( std::bit_cast<double>( number.bits ) );
+	else if ( number.kind == detail::number_token::deferred )
+		result = new_lazy_number( string_view( start, number.length ) );
+	else
 		return make_error( error::syntax_error );
-#endif
 
 	return { error::none };
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-error parser::parse_string( detail::string_offset &result )
+error parser::parse_string( detail::value &result )
 {
 	static const constexpr char *hexChars = "0123456789abcdefABCDEF";
 
 	bool singleQuoted = peek() == '\'';
 	next(); // Consume '\'' or '"'
 
-	result = string_buffer_offset();
+	// When parsing in place, the string stays in the source buffer until the first escape sequence
+	const char *start = _cursor;
+	bool inSitu = _writable != nullptr;
+	detail::string_offset offset = inSitu ? 0 : string_buffer_offset();
 
+	bool closed = false;
 	while ( !eof() )
 	{
+		// Copy everything up to the next quote, escape sequence or line break at once
+		if ( size_t length = detail::scan_string_run( _cursor, _size ) )
+		{
+			if ( !inSitu )
+				string_buffer_append( _cursor, length );
+
+			advance( length );
+
+			if ( eof() )
+				break;
+		}
+
 		int ch = peek();
 		if ( ( ( singleQuoted && ch == '\'' ) || ( !singleQuoted && ch == '"' ) ) && next() ) // Consume '\'' or '"'
+		{
+			closed = true;
 			break;
-		else if ( ch == '\\' && next() ) // Consume '\\'
+		}
+		else if ( ch == '\\' )
 		{
+			if ( inSitu )
+			{
+				inSitu = false;
+				offset = string_buffer_offset();
+				string_buffer_append( start, _cursor - start );
+			}
+
+			next(); // Consume '\\'
+
 			ch = peek();
-			if ( ch == '\n' || ch == 'v' || ch == 'f' )
+			if ( ch == '\n' )
 				next();
+			else if ( ch == 'v' && next() )
+				string_buffer_add( '\v' );
+			else if ( ch == 'f' && next() )
+				string_buffer_add( '\f' );
 			else if ( ch == 't' && next() )
 				string_buffer_add( '\t' );
 			else if ( ch == 'n' && next() )
@@ -431,27 +1330,50 @@ error parser::parse_string( detail::string_offset &result )
 					return make_error( error::invalid_escape_seq );
 #endif
 
+				// UTF-16 surrogate pair is combined into one character
+				if ( ch == 'u' && unicodeChar >= 0xd800 && unicodeChar <= 0xdbff && _size >= 6 && _cursor[0] == '\\' && _cursor[1] == 'u' )
+				{
+					char low[5] = { _cursor[2], _cursor[3], _cursor[4], _cursor[5] };
+
+					if ( uint64_t lowChar = strspn( low, hexChars ) == 4 ? strtoull( low, nullptr, 16 ) : 0; lowChar >= 0xdc00 && lowChar <= 0xdfff )
+					{
+						advance( 6 );
+						unicodeChar = 0x10000 + ( ( unicodeChar - 0xd800 ) << 10 ) + ( lowChar - 0xdc00 );
+					}
+				}
+
 				string_buffer_add_utf8( uint32_t( unicodeChar ) );
 			}
 			else
 				return make_error( error::invalid_escape_seq );
 		}
+		else if ( inSitu )
+			next();
 		else
 			string_buffer_add( next() );
 	}
 
-	if ( eof() )
+	// Closing quote can be the last character of the input
+	if ( !closed )
 		return make_error( error::unexpected_end );
 
-	string_buffer_add( 0 );
+	if ( inSitu )
+	{
+		_writable[_cursor - _writable - 1] = 0; // Closing quote
+		result = detail::value( start );
+	}
+	else
+	{
+		string_buffer_add( 0 );
+		result = new_string( offset );
+	}
+
 	return { error::none };
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-error parser::parse_identifier( detail::string_offset &result )
+error parser::parse_identifier( detail::value &result )
 {
-	result = string_buffer_offset();
-
 	int firstCh = peek();
 	bool isString = ( firstCh == '\'' ) || ( firstCh == '"' );
 
@@ -462,22 +1384,109 @@ error parser::parse_identifier( detail::string_offset &result )
 			return make_error( error::syntax_error );
 	}
 
-	while ( !eof() )
-	{
-		string_buffer_add( next() );
+	// Quoted keys are terminated in place when parsing in place, others are copied (or interned)
+	const char *start = _cursor;
+	bool inSitu = isString && _writable != nullptr;
+	detail::string_offset offset = 0;
 
-		int ch = peek();
-		if ( !isalpha( ch ) && !isdigit( ch ) && ch != '_' )
-			break;
-	}
+	// The first character is already validated, copy the whole identifier at once
+	size_t length = _size ? 1 : 0;
+	while ( length < _size && ( isalnum( uint8_t( _cursor[length] ) ) || _cursor[length] == '_' ) )
+		++length;
+
+	if ( !inSitu )
+		offset = _internKeys ? intern_key( string_view( _cursor, length ) ) : string_buffer_add( string_view( _cursor, length ) );
+
+	advance( length );
 
 	if ( isString && firstCh != next() ) // Consume '\'' or '"'
 		return make_error( error::syntax_error );
 
-	string_buffer_add( 0 );
+	if ( inSitu )
+	{
+		_writable[_cursor - _writable - 1] = 0; // Closing quote
+		result = detail::value( start );
+	}
+	else
+		result = new_string( offset );
+
 	return { error::none };
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+error parser::begin_container( bool isObject, size_t count )
+{
+	if ( !_handler )
+		isObject ? push_object( count ) : push_array( count );
+	else if ( !( isObject ? _handler->on_object_begin() : _handler->on_array_begin() ) )
+		return make_error( error::aborted );
+
+	return { error::none };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+error parser::end_container( bool isObject, detail::value &result )
+{
+	if ( !_handler )
+	{
+		result = pop();
+		return { error::none };
+	}
+
+	// Empty placeholder, only its type is checked for the document root
+	result = detail::value( isObject ? value_type::object : value_type::array, nullptr );
+
+	if ( !( isObject ? _handler->on_object_end() : _handler->on_array_end() ) )
+		return make_error( error::aborted );
+
+	return { error::none };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+error parser::emit_key( const detail::value &key )
+{
+	bool ok = _handler->on_key( key_string( key ) );
+
+	// Only the leading '\0' is kept between events
+	string_buffer_discard( 1 );
+
+	return ok ? error{ error::none } : make_error( error::aborted );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+error parser::emit_value( const detail::value &v )
+{
+	const uint64_t tag = v._data & detail::value::mask_tag;
+	bool ok = true;
+
+	if ( tag == detail::value::type_int )
+		ok = _handler->on_int64( int64_t( v._data << 16 ) >> 16 );
+	else if ( tag == detail::value::type_int64_off || tag == detail::value::type_uint64_off )
+	{
+		uint64_t bits = 0;
+		memcpy( &bits, string_buffer_data( v.payload<detail::string_offset>() ), sizeof( bits ) );
+		ok = ( tag == detail::value::type_int64_off ) ? _handler->on_int64( int64_t( bits ) ) : _handler->on_uint64( bits );
+	}
+	else if ( v.is_number() )
+		ok = _handler->on_number( v._double );
+	else if ( ( v._data & detail::value::mask_type ) == detail::value::type_string_off )
+	{
+		// Terminating '\0' is the last byte in the buffer, escaped '\0' can be reported too
+		auto offset = v.payload<detail::string_offset>();
+		ok = _handler->on_string( string_view( string_buffer_data( offset ), string_buffer_offset() - offset - 1 ) );
+	}
+	else if ( v.is_string() )
+		ok = _handler->on_string( v.get_c_str() );
+	else if ( v.is_boolean() )
+		ok = _handler->on_boolean( v.get_bool() );
+	else
+		ok = _handler->on_null();
+
+	string_buffer_discard( 1 );
+
+	return ok ? error{ error::none } : make_error( error::aborted );
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 error parser::parse_literal( token_type &result )
 {
@@ -519,6 +1528,15 @@ error parser::parse_literal( token_type &result )
 			return { error::none };
 		}
 	}
+	// "Infinity"
+	else if ( ch == 'I' )
+	{
+		if ( next() && next() == 'n' && next() == 'f' && next() == 'i' && next() == 'n' && next() == 'i' && next() == 't' && next() == 'y' )
+		{
+			result = token_type::literal_Infinity;
+			return { error::none };
+		}
+	}
 
 
 	return make_error( error::invalid_literal );
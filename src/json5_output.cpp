@@ -3,219 +3,624 @@
 #include "json5_output.hpp"
 
 #include "json5.hpp"
+#include "json5_scanner.hpp"
 
+#include <cerrno>
 #include <cinttypes>
+#include <cmath>
+
+#if defined(_JSON5_HAS_UNISTD)
+	#include <unistd.h>
+#endif
 
 namespace json5 {
 
 //---------------------------------------------------------------------------------------------------------------------
-void to_string( string &str, const char *utf8Str, char quotes, bool escapeUnicode ) {
-	if ( quotes )
-		str += quotes;
+output_sink::output_sink( char *buffer, size_t size ) noexcept
+	: _buffer( buffer )
+	, _cursor( buffer )
+	, _end( buffer + size )
+{}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool output_sink::finish() {
+	flush_buffer();
+	return !_failed;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool output_sink::failed() const noexcept {
+	return _failed;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void output_sink::write_slow( const char *str, size_t length ) {
+	flush_buffer();
 
-	while ( *utf8Str )
+	// Long strings are passed on without copying
+	if ( length > size_t( _end - _cursor ) )
 	{
-		bool advance = true;
-
-		if ( utf8Str[0] == '\n' )
-			str += "\\n";
-		else if ( utf8Str[0] == '\r' )
-			str += "\\r";
-		else if ( utf8Str[0] == '\t' )
-			str += "\\t";
-		else if ( utf8Str[0] == '"' && quotes == '"' )
-			str += "\\\"";
-		else if ( utf8Str[0] == '\'' && quotes == '\'' )
-			str += "\\'";
-		else if ( utf8Str[0] == '\\' )
-			str += "\\\\";
-		else if ( uint8_t( utf8Str[0] ) >= 128 && escapeUnicode )
+		_failed = _failed || !flush( str, length );
+		return;
+	}
+
+	memcpy( _cursor, str, length );
+	_cursor += length;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void output_sink::flush_buffer() {
+	if ( _cursor != _buffer )
+		_failed = _failed || !flush( _buffer, _cursor - _buffer );
+
+	_cursor = _buffer;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+buffered_sink::buffered_sink() noexcept
+	: output_sink( _storage, sizeof( _storage ) )
+{}
+
+//---------------------------------------------------------------------------------------------------------------------
+string_sink::string_sink( string &str ) noexcept
+	: _str( str )
+{}
+
+bool string_sink::flush( const char *data, size_t length ) {
+	_str.append( data, length );
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+file_sink::file_sink( FILE *file ) noexcept
+	: _file( file )
+{}
+
+bool file_sink::flush( const char *data, size_t length ) {
+	return fwrite( data, 1, length, _file ) == length;
+}
+
+#if defined(_JSON5_HAS_UNISTD)
+//---------------------------------------------------------------------------------------------------------------------
+fd_sink::fd_sink( int fd ) noexcept
+	: _fd( fd )
+{}
+
+bool fd_sink::flush( const char *data, size_t length ) {
+	// Pipes and sockets may accept only a part of the data
+	while ( length )
+	{
+		ssize_t written = ::write( _fd, data, length );
+
+		if ( written < 0 && errno == EINTR )
+			continue;
+		else if ( written <= 0 )
+			return false;
+
+		data += written;
+		length -= size_t( written );
+	}
+
+	return true;
+}
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+callback_sink::callback_sink( std::function<bool( const char *data, size_t length )> fn ) noexcept
+	: _fn( _JSON5_MOVE( fn ) )
+{}
+
+bool callback_sink::flush( const char *data, size_t length ) {
+	return _fn( data, length );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------------------------------------------------
+// Decodes UTF-8 sequence at 'str' into 'ch', returns its length. Invalid or truncated sequences are decoded
+// byte by byte as U+FFFD.
+static size_t decode_utf8( const uint8_t *str, uint32_t &ch ) noexcept {
+	size_t length = ( str[0] >= 0xf0 && str[0] <= 0xf4 ) ? 4 : ( str[0] >= 0xe0 ) ? 3 : ( str[0] >= 0xc2 ) ? 2 : 0;
+
+	if ( length == 0 || str[0] > 0xf4 )
+	{
+		ch = 0xfffd;
+		return 1;
+	}
+
+	ch = str[0] & ( 0x7f >> length );
+
+	for ( size_t i = 1; i < length; ++i )
+	{
+		// Also stops at the terminating '\0'
+		if ( ( str[i] & 0b1100'0000u ) != 0b1000'0000u )
 		{
-			uint32_t ch = 0;
+			ch = 0xfffd;
+			return 1;
+		}
 
-			if ( ( *utf8Str & 0b1110'0000u ) == 0b1100'0000u )
-			{
-				ch |= ( ( *utf8Str++ ) & 0b0001'1111u ) << 6;
-				ch |= ( ( *utf8Str++ ) & 0b0011'1111u );
-			}
-			else if ( ( *utf8Str & 0b1111'0000u ) == 0b1110'0000u )
-			{
-				ch |= ( ( *utf8Str++ ) & 0b0000'1111u ) << 12;
-				ch |= ( ( *utf8Str++ ) & 0b0011'1111u ) << 6;
-				ch |= ( ( *utf8Str++ ) & 0b0011'1111u );
-			}
-			else if ( ( *utf8Str & 0b1111'1000u ) == 0b1111'0000u )
-			{
-				ch |= ( ( *utf8Str++ ) & 0b0000'0111u ) << 18;
-				ch |= ( ( *utf8Str++ ) & 0b0011'1111u ) << 12;
-				ch |= ( ( *utf8Str++ ) & 0b0011'1111u ) << 6;
-				ch |= ( ( *utf8Str++ ) & 0b0011'1111u );
-			}
-			else if ( ( *utf8Str & 0b1111'1100u ) == 0b1111'1000u )
-			{
-				ch |= ( ( *utf8Str++ ) & 0b0000'0011u ) << 24;
-				ch |= ( ( *utf8Str++ ) & 0b0011'1111u ) << 18;
-				ch |= ( ( *utf8Str++ ) & 0b0011'1111u ) << 12;
-				ch |= ( ( *utf8Str++ ) & 0b0011'1111u ) << 6;
-				ch |= ( ( *utf8Str++ ) & 0b0011'1111u );
-			}
-			else if ( ( *utf8Str & 0b1111'1110u ) == 0b1111'1100u )
-			{
-				ch |= ( ( *utf8Str++ ) & 0b0000'0001u ) << 30;
-				ch |= ( ( *utf8Str++ ) & 0b0011'1111u ) << 24;
-				ch |= ( ( *utf8Str++ ) & 0b0011'1111u ) << 18;
-				ch |= ( ( *utf8Str++ ) & 0b0011'1111u ) << 12;
-				ch |= ( ( *utf8Str++ ) & 0b0011'1111u ) << 6;
-				ch |= ( ( *utf8Str++ ) & 0b0011'1111u );
-			}
+		ch = ( ch << 6 ) | ( str[i] & 0b0011'1111u );
+	}
 
-			if ( ch <= std::numeric_limits<uint16_t>::max() )
-			{
-				JSON5_ASSERT( 0 ); // TODO
+	return length;
+}
 
-				//os << "\\u" << std::hex << std::setfill( '0' ) << std::setw( 4 ) << ch;
-			}
-			else
-				str += "?"; // JSON can't encode Unicode chars > 65535 (emojis)
+//---------------------------------------------------------------------------------------------------------------------
+static void append_unicode_escape( output_sink &sink, uint32_t ch ) {
+	static constexpr char hexDigits[] = "0123456789abcdef";
+	char buff[6] = { '\\', 'u' };
+
+	for ( int i = 0; i < 4; ++i )
+		buff[2 + i] = hexDigits[( ch >> ( 12 - i * 4 ) ) & 0xf];
+
+	sink.write( buff, 6 );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void to_string( output_sink &sink, const char *utf8Str, char quotes, bool escapeUnicode ) {
+	if ( quotes )
+		sink.write( quotes );
+
+	const char *end = utf8Str + strlen( utf8Str );
+
+	while ( utf8Str < end )
+	{
+		// Characters, that don't need escaping, are appended at once
+		if ( size_t run = detail::scan_escape_run( utf8Str, end - utf8Str, escapeUnicode ) )
+		{
+			sink.write( utf8Str, run );
+			utf8Str += run;
+
+			if ( utf8Str == end )
+				break;
+		}
 
-			advance = false;
+		const char ch = *utf8Str++;
+
+		if ( ch == '\n' )
+			sink.write( "\\n" );
+		else if ( ch == '\r' )
+			sink.write( "\\r" );
+		else if ( ch == '\t' )
+			sink.write( "\\t" );
+		else if ( ch == '\b' )
+			sink.write( "\\b" );
+		else if ( ch == '\f' )
+			sink.write( "\\f" );
+		else if ( ch == '\\' )
+			sink.write( "\\\\" );
+		else if ( ch == '"' || ch == '\'' )
+		{
+			// Only the enclosing quotes are escaped
+			if ( ch == quotes )
+				sink.write( '\\' );
+
+			sink.write( ch );
 		}
+		else if ( uint8_t( ch ) < 32 )
+			append_unicode_escape( sink, uint8_t( ch ) );
 		else
-			str += *utf8Str;
+		{
+			// Non-ASCII character, characters outside of the BMP are written as UTF-16 surrogate pair
+			uint32_t code = 0;
+			utf8Str += decode_utf8( reinterpret_cast<const uint8_t *>( utf8Str - 1 ), code ) - 1;
 
-		if ( advance )
-			++utf8Str;
+			if ( code >= 0x10000 )
+			{
+				append_unicode_escape( sink, 0xd800 + ( ( code - 0x10000 ) >> 10 ) );
+				append_unicode_escape( sink, 0xdc00 + ( ( code - 0x10000 ) & 0x3ff ) );
+			}
+			else
+				append_unicode_escape( sink, code );
+		}
 	}
 
 	if ( quotes )
-		str += quotes;
+		sink.write( quotes );
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-void to_string( string &str, const detail::value &v, const writer_params &wp, int depth ) {
-	const char *kvSeparator = ": ";
-	const char *eol = wp.eol;
+void to_string_number( output_sink &sink, const detail::value &v, bool jsonCompatible ) {
+	double d = v.get_number( 0.0 );
 
-	if ( wp.compact )
+	if ( std::isnan( d ) && !v.is_integer() )
+	{
+		sink.write( jsonCompatible ? "null" : "NaN" );
+		return;
+	}
+	else if ( std::isinf( d ) && !v.is_integer() )
 	{
-		depth = -1;
-		kvSeparator = ":";
-		eol = "";
+		sink.write( jsonCompatible ? "null" : ( d < 0.0 ? "-Infinity" : "Infinity" ) );
+		return;
 	}
 
+	// 32 characters fit any integer or shortest double
+	char buff[32];
+	char *first = buff, *last = buff + sizeof( buff );
+
+#if defined(_JSON5_HAS_CHARCONV)
+	if ( v.is_integer() && d < 0.0 )
+		last = std::to_chars( first, last, v.get_number<int64_t>() ).ptr;
+	else if ( v.is_integer() )
+		last = std::to_chars( first, last, v.get_number<uint64_t>() ).ptr;
+	else
+		last = std::to_chars( first, last, d ).ptr;
+#else
+	if ( v.is_integer() && d < 0.0 )
+		last = first + snprintf( first, last - first, "%" PRIi64, v.get_number<int64_t>() );
+	else if ( v.is_integer() )
+		last = first + snprintf( first, last - first, "%" PRIu64, v.get_number<uint64_t>() );
+	else
+		last = first + snprintf( first, last - first, "%.17g", d );
+#endif
+
+	sink.write( first, last - first );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+//---------------------------------------------------------------------------------------------------------------------
+// Writes values into sink, the choice between compact and pretty printed output is made once per value written.
+// A line break followed by indentation is a single write of a prefix of '_lines'.
+class value_writer final
+{
+public:
+	value_writer( output_sink &sink, const writer_params &wp );
+
+	void write( const value &v, int depth );
+
+private:
+	void write_scalar( const value &v );
+	void write_key( string_view key );
+	void write_compact( const value &v );
+	void write_pretty( const value &v, int depth );
+
+	// Starts new line indented for 'depth'
+	void new_line( int depth );
+
+	output_sink &_sink;
+	const writer_params &_wp;
+
+	// 'eol' followed by indentation repeated '_levels' times (as many as fit)
+	char _lines[256];
+	size_t _levels = 0;
+	size_t _eolLength = 0;
+	size_t _indentationLength = 0;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+value_writer::value_writer( output_sink &sink, const writer_params &wp )
+	: _sink( sink )
+	, _wp( wp )
+	, _eolLength( strlen( wp.eol ) )
+	, _indentationLength( strlen( wp.indentation ) )
+{
+	// Prepared in place, writing into caller memory must not allocate
+	if ( _eolLength > sizeof( _lines ) )
+		return;
+
+	memcpy( _lines, wp.eol, _eolLength );
+
+	if ( !_indentationLength )
+		_levels = size_t( -1 );
+	else
+		for ( char *p = _lines + _eolLength; p + _indentationLength <= _lines + sizeof( _lines ); p += _indentationLength, ++_levels )
+			memcpy( p, wp.indentation, _indentationLength );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void value_writer::write( const value &v, int depth ) {
+	if ( _wp.compact )
+		return write_compact( v );
+
+	write_pretty( v, depth );
+
+	if ( !depth )
+		_sink.write( _wp.eol );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void value_writer::write_scalar( const value &v ) {
 	if ( v.is_null() )
-		str += "null";
+		_sink.write( "null" );
 	else if ( v.is_boolean() )
-		str += ( v.get_bool() ? "true" : "false" );
+		_sink.write( v.get_bool() ? "true" : "false" );
 	else if ( v.is_number() )
-	{
-		char buff[64] = { };
-
-		if ( double _, d = v.get_number( 0.0 ); modf( d, &_ ) == 0.0 ) // Omit trailing zeros
-			sprintf( buff, "%" PRIi64, int64_t( d ) );
-		else
-			sprintf( buff, "%lf", d );
+		to_string_number( _sink, v, _wp.json_compatible );
+	else if ( v.is_string() )
+		to_string( _sink, v.get_c_str(), '"', _wp.escape_unicode );
+}
 
-		str += buff;
+//---------------------------------------------------------------------------------------------------------------------
+void value_writer::write_key( string_view key ) {
+	if ( _wp.json_compatible )
+	{
+		_sink.write( '"' );
+		_sink.write( key );
+		_sink.write( '"' );
 	}
-	else if ( v.is_string() )
+	else
+		_sink.write( key );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void value_writer::write_compact( const value &v ) {
+	if ( v.is_array() )
 	{
-		to_string( str, v.get_c_str(), '"', wp.escape_unicode );
+		auto av = json5::array_view( v );
+		if ( av.empty() )
+			return _sink.write( "[]" );
+
+		// Small arrays keep spaces around items
+		bool spaced = ( av.size() <= _wp.compact_array_size );
+
+		_sink.write( '[' );
+
+		for ( size_t i = 0, S = av.size(); i < S; ++i )
+		{
+			if ( i ) _sink.write( ',' );
+			if ( spaced ) _sink.write( ' ' );
+			write_compact( av[i] );
+		}
+
+		_sink.write( spaced ? " ]" : "]" );
 	}
-	else if ( v.is_array() )
+	else if ( v.is_object() )
 	{
-		if ( auto av = json5::array_view( v ); !av.empty() )
+		auto ov = json5::object_view( v );
+		if ( ov.empty() )
+			return _sink.write( "{}" );
+
+		bool spaced = ( ov.size() <= _wp.compact_object_size );
+		bool first = true;
+
+		_sink.write( '{' );
+
+		for ( const auto &kvp : ov )
 		{
-			bool compact = ( av.size() <= wp.compact_array_size );
+			if ( !first ) _sink.write( ',' );
+			if ( spaced ) _sink.write( ' ' );
+			first = false;
 
-			str += "[";
+			write_key( kvp.first );
+			_sink.write( ':' );
+			write_compact( kvp.second );
+		}
 
-			if ( !compact )
-				str += eol;
+		_sink.write( spaced ? " }" : "}" );
+	}
+	else
+		write_scalar( v );
+}
 
-			for ( size_t i = 0, S = av.size(); i < S; ++i )
-			{
-				if ( compact )
-					str += " ";
-				else
-					for ( int i = 0; i <= depth; ++i ) str += wp.indentation;
+//---------------------------------------------------------------------------------------------------------------------
+void value_writer::write_pretty( const value &v, int depth ) {
+	if ( v.is_array() )
+	{
+		auto av = json5::array_view( v );
+		if ( av.empty() )
+			return _sink.write( "[]" );
 
-				to_string( str, av[i], wp, depth + 1 );
-				if ( i < S - 1 ) str += ",";
+		bool compact = ( av.size() <= _wp.compact_array_size );
 
-				if ( !compact )
-					str += eol;
-			}
+		_sink.write( '[' );
+
+		for ( size_t i = 0, S = av.size(); i < S; ++i )
+		{
+			if ( i ) _sink.write( ',' );
 
 			if ( compact )
-				str += " ]";
+				_sink.write( ' ' );
 			else
-			{
-				for ( int i = 0; i < depth; ++i ) str += wp.indentation;
-				str += "]";
-			}
+				new_line( depth + 1 );
+
+			write_pretty( av[i], depth + 1 );
 		}
+
+		if ( compact )
+			_sink.write( " ]" );
 		else
-			str += "[]";
+		{
+			new_line( depth );
+			_sink.write( ']' );
+		}
 	}
 	else if ( v.is_object() )
 	{
-		if ( auto ov = json5::object_view( v ); !ov.empty() )
-		{
-			bool compact = ( ov.size() <= wp.compact_object_size );
+		auto ov = json5::object_view( v );
+		if ( ov.empty() )
+			return _sink.write( "{}" );
 
-			str += "{";
+		bool compact = ( ov.size() <= _wp.compact_object_size );
+		bool first = true;
 
-			if ( !compact )
-				str += eol;
+		_sink.write( '{' );
 
-			size_t count = ov.size();
-			for ( const auto &kvp : ov )
-			{
-				if ( compact )
-					str += " ";
-				else
-					for ( int i = 0; i <= depth; ++i ) str += wp.indentation;
-
-				if ( wp.json_compatible )
-				{
-					str += "\"";
-					str += kvp.first;
-					str += "\"";
-				}
-				else
-					str += kvp.first;
-
-				str += kvSeparator;
-
-				to_string( str, kvp.second, wp, depth + 1 );
-				if ( --count ) str += ",";
-
-				if ( !compact )
-					str += eol;
-			}
+		for ( const auto &kvp : ov )
+		{
+			if ( !first ) _sink.write( ',' );
+			first = false;
 
 			if ( compact )
-				str += " }";
+				_sink.write( ' ' );
 			else
-			{
-				for ( int i = 0; i < depth; ++i ) str += wp.indentation;
-				str += "}";
-			}
+				new_line( depth + 1 );
+
+			write_key( kvp.first );
+			_sink.write( ": " );
+			write_pretty( kvp.second, depth + 1 );
 		}
+
+		if ( compact )
+			_sink.write( " }" );
 		else
-			str += "{}";
+		{
+			new_line( depth );
+			_sink.write( '}' );
+		}
 	}
+	else
+		write_scalar( v );
+}
 
-	if ( !depth )
-		str += eol;
+//---------------------------------------------------------------------------------------------------------------------
+void value_writer::new_line( int depth ) {
+	size_t levels = size_t( depth > 0 ? depth : 0 );
+
+	if ( levels <= _levels && _eolLength <= sizeof( _lines ) )
+		return _sink.write( _lines, _eolLength + _indentationLength * levels );
+
+	// Deeper levels (or very long 'eol') are written in pieces
+	_sink.write( _wp.eol, _eolLength );
+
+	for ( size_t i = 0; i < levels; ++i )
+		_sink.write( _wp.indentation, _indentationLength );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Counts written characters, the buffer only collects pieces between counting
+class size_sink final : public output_sink
+{
+public:
+	size_sink() noexcept : output_sink( _storage, sizeof( _storage ) ) {}
+
+	size_t size() const noexcept { return _size; }
+
+protected:
+	bool flush( const char *, size_t length ) override
+	{
+		_size += length;
+		return true;
+	}
+
+private:
+	char _storage[4096];
+	size_t _size = 0;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Appends output to string through a small buffer, the low-level string overloads write single strings or numbers
+// mostly, so the 64 KiB buffer of string_sink would be wasted on them
+class small_string_sink final : public output_sink
+{
+public:
+	explicit small_string_sink( string &str ) noexcept : output_sink( _storage, sizeof( _storage ) ), _str( str ) {}
+
+protected:
+	bool flush( const char *data, size_t length ) override
+	{
+		_str.append( data, length );
+		return true;
+	}
+
+private:
+	char _storage[256];
+	string &_str;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Writes directly into caller memory used as the sink buffer. Complete output is flushed once from the start of the
+// buffer, flushing again means the buffer overflowed (and was reused), flushing other memory means a long string
+// did not fit.
+class memory_sink final : public output_sink
+{
+public:
+	memory_sink( char *buffer, size_t size ) noexcept : output_sink( buffer, size ), _begin( buffer ) {}
+
+	size_t size() const noexcept { return _size; }
+
+protected:
+	bool flush( const char *data, size_t length ) override
+	{
+		if ( data != _begin || _flushed )
+			return false;
+
+		_flushed = true;
+		_size = length;
+		return true;
+	}
+
+private:
+	const char *_begin = nullptr;
+	size_t _size = 0;
+	bool _flushed = false;
+};
+
+} // namespace detail
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------------------------------------------------
+void to_string( output_sink &sink, const detail::value &v, const writer_params &wp, int depth ) {
+	detail::value_writer( sink, wp ).write( v, depth );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Rough size of written document: its strings, a few characters per value and the indentation of a line per value
+static size_t estimate_size( const document &doc, const writer_params &wp ) noexcept {
+	size_t perValue = 4;
+
+	if ( !wp.compact )
+		perValue += strlen( wp.eol ) + strlen( wp.indentation ) * 2;
+
+	return doc.strings_size() + doc.values_size() * perValue;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void to_string( string &str, const char *utf8Str, char quotes, bool escapeUnicode ) {
+	detail::small_string_sink sink( str );
+	to_string( sink, utf8Str, quotes, escapeUnicode );
+	sink.finish();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void to_string_number( string &str, const detail::value &v, bool jsonCompatible ) {
+	detail::small_string_sink sink( str );
+	to_string_number( sink, v, jsonCompatible );
+	sink.finish();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void to_string( string &str, const detail::value &v, const writer_params &wp, int depth ) {
+	detail::small_string_sink sink( str );
+	to_string( sink, v, wp, depth );
+	sink.finish();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void to_string( string &str, const document &doc, const writer_params &wp ) {
+	str.reserve( str.size() + estimate_size( doc, wp ) );
+
+	string_sink sink( str );
+	to_sink( sink, doc, wp );
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 string to_string( const document &doc, const writer_params &wp ) {
 	string result;
-	to_string( result, doc, wp, 0 );
+	to_string( result, doc, wp );
 	return result;
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+bool to_sink( output_sink &sink, const document &doc, const writer_params &wp ) {
+	to_string( sink, doc, wp, 0 );
+	return sink.finish();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+size_t measure( const document &doc, const writer_params &wp ) {
+	detail::size_sink sink;
+	to_sink( sink, doc, wp );
+	return sink.size();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+size_t to_buffer( char *buffer, size_t size, const document &doc, const writer_params &wp ) {
+	detail::memory_sink sink( buffer, size );
+	return to_sink( sink, doc, wp ) ? sink.size() : 0;
+}
+
 } // namespace json5
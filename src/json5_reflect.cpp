@@ -22,6 +22,23 @@ const writer_params& writer::params() const noexcept {
 	return _params;
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+reader::reader( const document &doc ) noexcept
+	:	_doc( &doc )
+{}
+
+error reader::make_error( int type, const value &in ) const noexcept {
+	return { type, _doc ? _doc->loc( in ) : in.loc() };
+}
+
+error reader::make_error( int type, const array_view &arr ) const noexcept {
+	if ( !_doc )
+		return { type, arr.loc() };
+
+	// Arrays are located by their header preceding the first item
+	return { type, arr.is_valid() ? _doc->loc( arr.source()[-1] ) : location() };
+}
+
 
 //---------------------------------------------------------------------------------------------------------------------
 string_view get_name_slice( const char *names, size_t index ) {
@@ -43,45 +60,54 @@ string_view get_name_slice( const char *names, size_t index ) {
 
 //---------------------------------------------------------------------------------------------------------------------
 value write( writer &w, bool in ) { return value( in ); }
-value write( writer &w, int in ) { return value( double( in ) ); }
-value write( writer &w, unsigned in ) { return value( double( in ) ); }
+value write( writer &w, int in ) { return value( in ); }
+value write( writer &w, unsigned in ) { return w.new_uint64( in ); }
 value write( writer &w, float in ) { return value( double( in ) ); }
 value write( writer &w, double in ) { return value( in ); }
 value write( writer &w, const char *in ) { return w.new_string( in ); }
 value write( writer &w, const string &in ) { return w.new_string( in ); }
 
 //---------------------------------------------------------------------------------------------------------------------
-error read( const value &in, bool &out ) {
+error read( const reader &r, const value &in, bool &out ) {
 	if ( !in.is_boolean() )
-		return { error::number_expected, in.loc() };
+		return r.make_error( error::number_expected, in );
 
 	out = in.get_bool();
 	return { error::none };
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-error read( const value &in, int &out ) { return read_number( in, out ); }
-error read( const value &in, unsigned &out ) { return read_number( in, out ); }
-error read( const value &in, float &out ) { return read_number( in, out ); }
-error read( const value &in, double &out ) { return read_number( in, out ); }
+error read( const reader &r, const value &in, int &out ) { return read_number( r, in, out ); }
+error read( const reader &r, const value &in, unsigned &out ) { return read_number( r, in, out ); }
+error read( const reader &r, const value &in, float &out ) { return read_number( r, in, out ); }
+error read( const reader &r, const value &in, double &out ) { return read_number( r, in, out ); }
 
 //---------------------------------------------------------------------------------------------------------------------
-error read( const value &in, const char *&out ) {
+error read( const reader &r, const value &in, const char *&out ) {
 	if ( !in.is_string() )
-		return { error::string_expected, in.loc() };
+		return r.make_error( error::string_expected, in );
 
 	out = in.get_c_str();
 	return { error::none };
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-error read( const value &in, string &out ) {
+error read( const reader &r, const value &in, string &out ) {
 	if ( !in.is_string() )
-		return { error::string_expected, in.loc() };
+		return r.make_error( error::string_expected, in );
 
 	out = in.get_c_str();
 	return { error::none };
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+error read( const value &in, bool &out ) { return read( reader(), in, out ); }
+error read( const value &in, int &out ) { return read( reader(), in, out ); }
+error read( const value &in, unsigned &out ) { return read( reader(), in, out ); }
+error read( const value &in, float &out ) { return read( reader(), in, out ); }
+error read( const value &in, double &out ) { return read( reader(), in, out ); }
+error read( const value &in, const char *&out ) { return read( reader(), in, out ); }
+error read( const value &in, string &out ) { return read( reader(), in, out ); }
+
 
 } // json5::detail
@@ -0,0 +1,707 @@
+#pragma once
+
+#include "json5_scanner.hpp"
+
+#include <bit>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined( _JSON5_HAS_SSE2 )
+	#include <immintrin.h>
+	#if defined( _MSC_VER ) && !defined( __clang__ )
+		#include <intrin.h>
+		#define _JSON5_TARGET_AVX2
+	#else
+		#define _JSON5_TARGET_AVX2 __attribute__( ( target( "avx2" ) ) )
+	#endif
+#endif
+
+namespace json5::detail {
+
+//---------------------------------------------------------------------------------------------------------------------
+static block_masks classify_scalar( const char *block ) noexcept
+{
+	block_masks result;
+
+	for ( size_t i = 0; i < 64; ++i )
+	{
+		const uint64_t bit = uint64_t( 1 ) << i;
+
+		switch ( char_classes[block[i]] )
+		{
+			case cc_whitespace: result.whitespace |= bit; break;
+			case cc_structural: result.structural |= bit; break;
+			case cc_quote: result.quote |= bit; break;
+			case cc_comment: result.comment |= bit; break;
+			default: break;
+		}
+
+		if ( block[i] == '\\' )
+			result.backslash |= bit;
+		else if ( block[i] == '\n' )
+			result.line_break |= bit;
+	}
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+static uint64_t escapes_scalar( const char *block, bool nonAscii ) noexcept
+{
+	uint64_t result = 0;
+
+	for ( size_t i = 0; i < 64; ++i )
+	{
+		const uint8_t ch = uint8_t( block[i] );
+
+		if ( ch < 32 || ch == '"' || ch == '\'' || ch == '\\' || ( nonAscii && ch >= 128 ) )
+			result |= uint64_t( 1 ) << i;
+	}
+
+	return result;
+}
+
+#if defined( _JSON5_HAS_SSE2 )
+//---------------------------------------------------------------------------------------------------------------------
+static block_masks classify_sse2( const char *block ) noexcept
+{
+	const __m128i space = _mm_set1_epi8( 32 );
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i lowerCase = _mm_set1_epi8( 0x20 );
+	const __m128i braceOpen = _mm_set1_epi8( '{' );  // also matches '[' | 0x20
+	const __m128i braceClose = _mm_set1_epi8( '}' ); // also matches ']' | 0x20
+	const __m128i colon = _mm_set1_epi8( ':' );
+	const __m128i comma = _mm_set1_epi8( ',' );
+	const __m128i doubleQuote = _mm_set1_epi8( '"' );
+	const __m128i singleQuote = _mm_set1_epi8( '\'' );
+	const __m128i slash = _mm_set1_epi8( '/' );
+	const __m128i backslash = _mm_set1_epi8( '\\' );
+	const __m128i lineBreak = _mm_set1_epi8( '\n' );
+
+	block_masks result;
+
+	for ( int i = 0; i < 4; ++i )
+	{
+		const __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i *>( block + i * 16 ) );
+		const __m128i folded = _mm_or_si128( v, lowerCase );
+
+		const __m128i ws = _mm_andnot_si128( _mm_cmpeq_epi8( v, zero ), _mm_cmpeq_epi8( _mm_min_epu8( v, space ), v ) );
+		const __m128i st = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( folded, braceOpen ), _mm_cmpeq_epi8( folded, braceClose ) ),
+		                                 _mm_or_si128( _mm_cmpeq_epi8( v, colon ), _mm_cmpeq_epi8( v, comma ) ) );
+		const __m128i qt = _mm_or_si128( _mm_cmpeq_epi8( v, doubleQuote ), _mm_cmpeq_epi8( v, singleQuote ) );
+		const __m128i cm = _mm_cmpeq_epi8( v, slash );
+
+		const int shift = i * 16;
+		result.whitespace |= uint64_t( uint16_t( _mm_movemask_epi8( ws ) ) ) << shift;
+		result.structural |= uint64_t( uint16_t( _mm_movemask_epi8( st ) ) ) << shift;
+		result.quote |= uint64_t( uint16_t( _mm_movemask_epi8( qt ) ) ) << shift;
+		result.comment |= uint64_t( uint16_t( _mm_movemask_epi8( cm ) ) ) << shift;
+		result.backslash |= uint64_t( uint16_t( _mm_movemask_epi8( _mm_cmpeq_epi8( v, backslash ) ) ) ) << shift;
+		result.line_break |= uint64_t( uint16_t( _mm_movemask_epi8( _mm_cmpeq_epi8( v, lineBreak ) ) ) ) << shift;
+	}
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+static uint64_t escapes_sse2( const char *block, bool nonAscii ) noexcept
+{
+	const __m128i control = _mm_set1_epi8( 31 );
+	const __m128i doubleQuote = _mm_set1_epi8( '"' );
+	const __m128i singleQuote = _mm_set1_epi8( '\'' );
+	const __m128i backslash = _mm_set1_epi8( '\\' );
+
+	uint64_t result = 0;
+
+	for ( int i = 0; i < 4; ++i )
+	{
+		const __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i *>( block + i * 16 ) );
+
+		// Unsigned v <= 31, the sign bit marks bytes >= 128
+		const __m128i esc = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( _mm_min_epu8( v, control ), v ), _mm_cmpeq_epi8( v, backslash ) ),
+		                                  _mm_or_si128( _mm_cmpeq_epi8( v, doubleQuote ), _mm_cmpeq_epi8( v, singleQuote ) ) );
+
+		const int mask = _mm_movemask_epi8( esc ) | ( nonAscii ? _mm_movemask_epi8( v ) : 0 );
+		result |= uint64_t( uint16_t( mask ) ) << ( i * 16 );
+	}
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+_JSON5_TARGET_AVX2 static uint64_t escapes_avx2( const char *block, bool nonAscii ) noexcept
+{
+	const __m256i control = _mm256_set1_epi8( 31 );
+	const __m256i doubleQuote = _mm256_set1_epi8( '"' );
+	const __m256i singleQuote = _mm256_set1_epi8( '\'' );
+	const __m256i backslash = _mm256_set1_epi8( '\\' );
+
+	uint64_t result = 0;
+
+	for ( int i = 0; i < 2; ++i )
+	{
+		const __m256i v = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( block + i * 32 ) );
+
+		const __m256i esc =
+		  _mm256_or_si256( _mm256_or_si256( _mm256_cmpeq_epi8( _mm256_min_epu8( v, control ), v ), _mm256_cmpeq_epi8( v, backslash ) ),
+		                   _mm256_or_si256( _mm256_cmpeq_epi8( v, doubleQuote ), _mm256_cmpeq_epi8( v, singleQuote ) ) );
+
+		const int mask = _mm256_movemask_epi8( esc ) | ( nonAscii ? _mm256_movemask_epi8( v ) : 0 );
+		result |= uint64_t( uint32_t( mask ) ) << ( i * 32 );
+	}
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+_JSON5_TARGET_AVX2 static block_masks classify_avx2( const char *block ) noexcept
+{
+	const __m256i space = _mm256_set1_epi8( 32 );
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i lowerCase = _mm256_set1_epi8( 0x20 );
+	const __m256i braceOpen = _mm256_set1_epi8( '{' );
+	const __m256i braceClose = _mm256_set1_epi8( '}' );
+	const __m256i colon = _mm256_set1_epi8( ':' );
+	const __m256i comma = _mm256_set1_epi8( ',' );
+	const __m256i doubleQuote = _mm256_set1_epi8( '"' );
+	const __m256i singleQuote = _mm256_set1_epi8( '\'' );
+	const __m256i slash = _mm256_set1_epi8( '/' );
+	const __m256i backslash = _mm256_set1_epi8( '\\' );
+	const __m256i lineBreak = _mm256_set1_epi8( '\n' );
+
+	block_masks result;
+
+	for ( int i = 0; i < 2; ++i )
+	{
+		const __m256i v = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( block + i * 32 ) );
+		const __m256i folded = _mm256_or_si256( v, lowerCase );
+
+		const __m256i ws =
+		  _mm256_andnot_si256( _mm256_cmpeq_epi8( v, zero ), _mm256_cmpeq_epi8( _mm256_min_epu8( v, space ), v ) );
+		const __m256i st =
+		  _mm256_or_si256( _mm256_or_si256( _mm256_cmpeq_epi8( folded, braceOpen ), _mm256_cmpeq_epi8( folded, braceClose ) ),
+		                   _mm256_or_si256( _mm256_cmpeq_epi8( v, colon ), _mm256_cmpeq_epi8( v, comma ) ) );
+		const __m256i qt = _mm256_or_si256( _mm256_cmpeq_epi8( v, doubleQuote ), _mm256_cmpeq_epi8( v, singleQuote ) );
+		const __m256i cm = _mm256_cmpeq_epi8( v, slash );
+
+		const int shift = i * 32;
+		result.whitespace |= uint64_t( uint32_t( _mm256_movemask_epi8( ws ) ) ) << shift;
+		result.structural |= uint64_t( uint32_t( _mm256_movemask_epi8( st ) ) ) << shift;
+		result.quote |= uint64_t( uint32_t( _mm256_movemask_epi8( qt ) ) ) << shift;
+		result.comment |= uint64_t( uint32_t( _mm256_movemask_epi8( cm ) ) ) << shift;
+		result.backslash |= uint64_t( uint32_t( _mm256_movemask_epi8( _mm256_cmpeq_epi8( v, backslash ) ) ) ) << shift;
+		result.line_break |= uint64_t( uint32_t( _mm256_movemask_epi8( _mm256_cmpeq_epi8( v, lineBreak ) ) ) ) << shift;
+	}
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+static bool cpu_has_avx2() noexcept
+{
+	#if defined( _MSC_VER ) && !defined( __clang__ )
+	int info[4] = { };
+	__cpuid( info, 1 );
+
+	// OS must save YMM registers (OSXSAVE + AVX, XCR0 bits 1 and 2)
+	if ( ( info[2] & ( 1 << 27 ) ) == 0 || ( info[2] & ( 1 << 28 ) ) == 0 || ( _xgetbv( 0 ) & 6 ) != 6 )
+		return false;
+
+	__cpuidex( info, 7, 0 );
+	return ( info[1] & ( 1 << 5 ) ) != 0;
+	#else
+	return __builtin_cpu_supports( "avx2" );
+	#endif
+}
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+const scanner &scanner::get() noexcept
+{
+	static const scanner instance = [] {
+		scanner result;
+		result.classify = classify_scalar;
+		result.escapes = escapes_scalar;
+		result.isa = "scalar";
+
+#if defined( _JSON5_HAS_SSE2 )
+		result.classify = classify_sse2;
+		result.escapes = escapes_sse2;
+		result.isa = "sse2";
+
+	#if defined( _JSON5_HAS_AVX2 )
+		if ( cpu_has_avx2() )
+		{
+			result.classify = classify_avx2;
+			result.escapes = escapes_avx2;
+			result.isa = "avx2";
+		}
+	#endif
+#endif
+
+		return result;
+	}();
+
+	return instance;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+block_masks classify( const char *str, size_t size ) noexcept
+{
+	if ( size >= 64 )
+		return scanner::get().classify( str );
+
+	char block[64] = { };
+	memcpy( block, str, size );
+	return scanner::get().classify( block );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+size_t skip_whitespace( const char *str, size_t size ) noexcept
+{
+	// Short runs (a single space after ':' or ',') are the common case
+	if ( size < 2 || char_classes[str[1]] != cc_whitespace )
+		return ( size && char_classes[str[0]] == cc_whitespace ) ? 1 : 0;
+
+	const auto classifyBlock = scanner::get().classify;
+
+	size_t offset = 0;
+	for ( ; offset + 64 <= size; offset += 64 )
+	{
+		if ( uint64_t other = ~classifyBlock( str + offset ).whitespace )
+			return offset + std::countr_zero( other );
+	}
+
+	// Padding NUL bytes are never whitespace, so the tail always terminates the run
+	uint64_t other = ~classify( str + offset, size - offset ).whitespace;
+	return offset + std::countr_zero( other );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+size_t scan_string_run( const char *str, size_t size ) noexcept
+{
+	const auto classifyBlock = scanner::get().classify;
+
+	size_t offset = 0;
+	for ( ; offset + 64 <= size; offset += 64 )
+	{
+		auto m = classifyBlock( str + offset );
+		if ( uint64_t stop = m.quote | m.backslash | m.line_break )
+			return offset + std::countr_zero( stop );
+	}
+
+	if ( offset == size )
+		return size;
+
+	auto m = classify( str + offset, size - offset );
+	uint64_t stop = ( m.quote | m.backslash | m.line_break ) & ( ( uint64_t( 1 ) << ( size - offset ) ) - 1 );
+	return stop ? offset + std::countr_zero( stop ) : size;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+size_t scan_escape_run( const char *str, size_t size, bool nonAscii ) noexcept
+{
+	const auto escapesBlock = scanner::get().escapes;
+
+	size_t offset = 0;
+	for ( ; offset + 64 <= size; offset += 64 )
+	{
+		if ( uint64_t stop = escapesBlock( str + offset, nonAscii ) )
+			return offset + std::countr_zero( stop );
+	}
+
+	if ( offset == size )
+		return size;
+
+	// Padding NUL bytes are control characters, the tail always stops
+	char block[64] = { };
+	memcpy( block, str + offset, size - offset );
+	return offset + std::countr_zero( escapesBlock( block, nonAscii ) );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+number_token scan_number( const char *str, size_t size, bool convert ) noexcept
+{
+	// Exactly representable powers of 10, multiplying or dividing by them rounds correctly (Clinger's fast path)
+	static constexpr double powersOf10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	number_token result;
+
+	const char *p = str;
+	const char *end = str + size;
+
+	auto isDigit = []( char ch ) noexcept { return unsigned( ch - '0' ) < 10; };
+	auto isLiteral = [&]( const char *literal, size_t length ) noexcept {
+		return size_t( end - p ) >= length && memcmp( p, literal, length ) == 0;
+	};
+
+	auto setFloating = [&]( double value ) noexcept {
+		result.kind = number_token::floating;
+		result.bits = std::bit_cast<uint64_t>( value );
+		result.length = size_t( p - str );
+		return result;
+	};
+
+	// Integer literals are exact, negative ones down to INT64_MIN
+	bool negative = p < end && *p == '-';
+
+	auto setInteger = [&]( uint64_t mantissa ) noexcept {
+		if ( negative && mantissa > ( uint64_t( 1 ) << 63 ) )
+			return setFloating( -double( mantissa ) );
+
+		result.kind = negative ? number_token::int64 : number_token::uint64;
+		result.bits = negative ? ~mantissa + 1 : mantissa;
+		result.length = size_t( p - str );
+		return result;
+	};
+
+	// Leading '+' is consumed by the tokenizer
+	if ( negative )
+		++p;
+
+	// "Infinity", "NaN"
+	if ( p < end && ( *p == 'I' || *p == 'N' ) )
+	{
+		if ( isLiteral( "Infinity", 8 ) )
+		{
+			p += 8;
+			return setFloating( negative ? -double( INFINITY ) : double( INFINITY ) );
+		}
+		else if ( isLiteral( "NaN", 3 ) )
+		{
+			p += 3;
+			return setFloating( double( NAN ) );
+		}
+
+		result.length = size_t( p - str );
+		return result;
+	}
+
+	// Hexadecimal integer
+	if ( end - p > 2 && p[0] == '0' && ( p[1] == 'x' || p[1] == 'X' ) && isxdigit( uint8_t( p[2] ) ) )
+	{
+		uint64_t mantissa = 0;
+		double value = 0.0;
+		int digits = 0;
+
+		for ( p += 2; p < end && isxdigit( uint8_t( *p ) ); ++p, ++digits )
+		{
+			int digit = isDigit( *p ) ? ( *p - '0' ) : ( ( *p | 0x20 ) - 'a' + 10 );
+
+			if ( digits < 16 )
+				mantissa = ( mantissa << 4 ) | uint64_t( digit );
+			else
+				value = ( digits == 16 ? double( mantissa ) : value ) * 16.0 + digit;
+		}
+
+		return ( digits <= 16 ) ? setInteger( mantissa ) : setFloating( negative ? -value : value );
+	}
+
+	// Decimal number, the first 19 significant digits are accumulated in 'mantissa'. Integer part takes a 20th
+	// digit, when it fits, so that integers up to UINT64_MAX stay exact.
+	const char *start = p;
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool hasDigits = false;
+	bool truncated = false;
+	bool integral = true;
+
+	for ( ; p < end && isDigit( *p ); ++p, hasDigits = true )
+	{
+		auto digit = uint64_t( *p - '0' );
+		if ( digits < 19 || ( digits == 19 && mantissa <= ( UINT64_MAX - digit ) / 10 ) )
+		{
+			mantissa = mantissa * 10 + digit;
+			digits += ( mantissa != 0 );
+		}
+		else
+		{
+			truncated |= ( *p != '0' );
+			++exponent;
+		}
+	}
+
+	if ( p < end && *p == '.' )
+	{
+		integral = false;
+
+		for ( ++p; p < end && isDigit( *p ); ++p, hasDigits = true )
+		{
+			if ( digits < 19 )
+			{
+				mantissa = mantissa * 10 + uint64_t( *p - '0' );
+				digits += ( mantissa != 0 );
+				--exponent;
+			}
+			else
+				truncated |= ( *p != '0' );
+		}
+	}
+
+	if ( !hasDigits )
+	{
+		result.length = size_t( p - str );
+		return result;
+	}
+
+	// Exponent is only consumed, when followed by digits
+	if ( p < end && ( *p == 'e' || *p == 'E' ) )
+	{
+		const char *e = p + 1;
+		bool negativeExp = e < end && *e == '-';
+		if ( e < end && ( *e == '-' || *e == '+' ) )
+			++e;
+
+		if ( e < end && isDigit( *e ) )
+		{
+			int exp = 0;
+			for ( ; e < end && isDigit( *e ); ++e )
+				exp = ( exp < 100000 ) ? exp * 10 + ( *e - '0' ) : exp;
+
+			exponent += negativeExp ? -exp : exp;
+			integral = false;
+			p = e;
+		}
+	}
+
+	// Negative zero is kept as double
+	if ( integral && !truncated && exponent == 0 && ( mantissa || !negative ) )
+		return setInteger( mantissa );
+
+	if ( !convert )
+	{
+		result.kind = number_token::deferred;
+		result.length = size_t( p - str );
+		return result;
+	}
+
+	double value = 0.0;
+
+	if ( !truncated && exponent == 0 )
+		value = double( mantissa );
+	else if ( !truncated && mantissa <= ( uint64_t( 1 ) << 53 ) && exponent >= -22 && exponent <= 22 )
+		value = ( exponent < 0 ) ? double( mantissa ) / powersOf10[-exponent] : double( mantissa ) * powersOf10[exponent];
+	else
+	{
+		// Rare case (more than 19 digits or large exponent), convert the scanned characters exactly
+#if defined(_JSON5_HAS_CHARCONV)
+		auto convResult = std::from_chars( start, p, value );
+
+		if ( convResult.ec == std::errc::result_out_of_range )
+			value = ( exponent > 0 ) ? double( INFINITY ) : 0.0;
+		else if ( convResult.ec != std::errc() )
+		{
+			result.length = size_t( p - str );
+			return result;
+		}
+#else
+		value = strtod( std::string( start, p ).c_str(), nullptr );
+#endif
+	}
+
+	return setFloating( negative ? -value : value );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// String or comment open at the end of a block, it continues from the first byte of the next block
+struct open_region
+{
+	enum class state { normal, string, line_comment, block_comment } current = state::normal;
+
+	char quote = 0;               // Quote character of the current string
+	size_t blockCommentStart = 0; // Offset of the current "/*"
+	bool escapeFirst = false;     // First byte of the next block follows a '\\' inside a string
+};
+
+// Walks quotes, slashes, backslashes and line breaks of the block at 'base' in order to find strings and comments.
+// Returns mask of bytes inside strings and comments, 'tokens' receives opening quotes and stray slashes.
+static uint64_t find_regions( open_region &region, const char *str, size_t size, size_t base, const block_masks &m,
+	uint64_t valid, uint64_t &tokens ) noexcept
+{
+	using state = open_region::state;
+
+	uint64_t special = ( m.quote | m.comment | m.backslash | m.line_break ) & valid;
+	uint64_t inside = 0;
+	int regionStart = 0;
+
+	tokens = 0;
+
+	if ( region.escapeFirst )
+	{
+		special &= ~uint64_t( 1 );
+		region.escapeFirst = false;
+	}
+
+	while ( special )
+	{
+		const int bit = std::countr_zero( special );
+		const size_t offset = base + bit;
+		const char ch = str[offset];
+		special &= special - 1;
+
+		switch ( region.current )
+		{
+			case state::normal:
+				if ( ch == '"' || ch == '\'' )
+				{
+					region.current = state::string;
+					region.quote = ch;
+					regionStart = bit;
+					tokens |= uint64_t( 1 ) << bit;
+				}
+				else if ( ch == '/' && offset + 1 < size && str[offset + 1] == '/' )
+				{
+					region.current = state::line_comment;
+					regionStart = bit;
+					special &= ~( uint64_t( 2 ) << bit );
+				}
+				else if ( ch == '/' && offset + 1 < size && str[offset + 1] == '*' )
+				{
+					region.current = state::block_comment;
+					regionStart = bit;
+					region.blockCommentStart = offset;
+				}
+				else if ( ch == '/' )
+					tokens |= uint64_t( 1 ) << bit;
+				break;
+
+			case state::string:
+				if ( ch == '\\' )
+				{
+					if ( bit == 63 )
+						region.escapeFirst = true;
+					else
+						special &= ~( uint64_t( 2 ) << bit );
+				}
+				else if ( ch == region.quote )
+				{
+					region.current = state::normal;
+					inside |= ( ~uint64_t( 0 ) << regionStart ) & ( ~uint64_t( 0 ) >> ( 63 - bit ) );
+				}
+				break;
+
+			case state::line_comment:
+				if ( ch == '\n' )
+				{
+					region.current = state::normal;
+					inside |= ( ~uint64_t( 0 ) << regionStart ) & ( ~uint64_t( 0 ) >> ( 63 - bit ) );
+				}
+				break;
+
+			case state::block_comment:
+				if ( ch == '/' && offset >= region.blockCommentStart + 3 && str[offset - 1] == '*' )
+				{
+					region.current = state::normal;
+					inside |= ( ~uint64_t( 0 ) << regionStart ) & ( ~uint64_t( 0 ) >> ( 63 - bit ) );
+				}
+				break;
+		}
+	}
+
+	if ( region.current != state::normal )
+		inside |= ~uint64_t( 0 ) << regionStart;
+
+	return inside;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void build_structural_index( const char *str, size_t size, std::vector<uint32_t> &index )
+{
+	const auto classifyBlock = scanner::get().classify;
+
+	open_region region;
+	uint64_t prevOther = 0; // Last byte of the previous block was part of a scalar token
+
+	index.clear();
+
+	for ( size_t base = 0; base < size; base += 64 )
+	{
+		const size_t length = ( size - base < 64 ) ? size - base : 64;
+		const uint64_t valid = ( length == 64 ) ? ~uint64_t( 0 ) : ( uint64_t( 1 ) << length ) - 1;
+		const block_masks m = ( length == 64 ) ? classifyBlock( str + base ) : classify( str + base, length );
+
+		// Scalar tokens (numbers, literals, identifiers) start where a run of other bytes begins
+		const uint64_t other = ~( m.whitespace | m.structural | m.quote | m.comment ) & valid;
+		const uint64_t scalars = other & ~( ( other << 1 ) | prevOther );
+		prevOther = other >> 63;
+
+		uint64_t tokens = 0; // Opening quotes and stray slashes
+		const uint64_t inside = find_regions( region, str, size, base, m, valid, tokens );
+
+		for ( uint64_t found = ( ( m.structural | scalars ) & ~inside ) | tokens; found; found &= found - 1 )
+			index.push_back( uint32_t( base + std::countr_zero( found ) ) );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool split_root_array( const char *str, size_t size, size_t chunkSize, std::vector<location> &splits )
+{
+	const auto classifyBlock = scanner::get().classify;
+
+	open_region region;
+	size_t depth = 0;
+	size_t nextSplit = 0;
+	unsigned line = 1;      // Line of the first byte of the current block
+	size_t lineStart = 0;   // Offset following the last line break before the current block
+
+	splits.clear();
+
+	for ( size_t base = 0; base < size; base += 64 )
+	{
+		const size_t length = ( size - base < 64 ) ? size - base : 64;
+		const uint64_t valid = ( length == 64 ) ? ~uint64_t( 0 ) : ( uint64_t( 1 ) << length ) - 1;
+		const block_masks m = ( length == 64 ) ? classifyBlock( str + base ) : classify( str + base, length );
+		const uint64_t lineBreaks = m.line_break & valid;
+
+		// Only brackets and commas are needed, other tokens matter only before the root
+		uint64_t tokens = 0;
+		const uint64_t inside = find_regions( region, str, size, base, m, valid, tokens );
+		uint64_t found = ( m.structural & ~inside ) | tokens;
+
+		if ( splits.empty() )
+			found |= ~( m.whitespace | m.comment | inside ) & valid;
+
+		for ( ; found; found &= found - 1 )
+		{
+			const int bit = std::countr_zero( found );
+			const size_t offset = base + bit;
+			const char ch = str[offset];
+
+			if ( splits.empty() && ch != '[' )
+				return false;
+
+			if ( ch == '[' || ch == '{' )
+				++depth;
+			else if ( ch == ']' || ch == '}' )
+			{
+				if ( --depth == 0 )
+					return true;
+			}
+
+			if ( splits.empty() || ( ch == ',' && depth == 1 && offset >= nextSplit ) )
+			{
+				// Location as the parser reports it, line breaks inside strings and comments are counted too
+				const uint64_t before = lineBreaks & ( ( uint64_t( 1 ) << bit ) - 1 );
+				const size_t start = before ? base + 64 - std::countl_zero( before ) : lineStart;
+
+				splits.push_back( location( line + unsigned( std::popcount( before ) ), unsigned( offset - start + 1 ),
+					unsigned( offset ) ) );
+				nextSplit = offset + chunkSize;
+			}
+		}
+
+		line += unsigned( std::popcount( lineBreaks ) );
+		if ( lineBreaks )
+			lineStart = base + 64 - std::countl_zero( lineBreaks );
+	}
+
+	return false;
+}
+
+} // namespace json5::detail
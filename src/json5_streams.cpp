@@ -7,26 +7,141 @@
 
 #include <fstream>
 
+#if defined( _JSON5_HAS_UNISTD )
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#if !defined( JSON5_DO_NOT_USE_MMAP ) && __has_include(<sys/mman.h>)
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+	#if !defined( _JSON5_HAS_MMAP )
+		#define _JSON5_HAS_MMAP
+	#endif
+#endif
+
+#if defined( _JSON5_HAS_MMAP )
+namespace json5::detail {
+
+//---------------------------------------------------------------------------------------------------------------------
+class mapped_file final
+{
+public:
+	// Maps whole regular file for reading, the mapping stays empty for other files (pipes, devices, ...)
+	explicit mapped_file( const char *fileName ) noexcept
+	{
+		int fd = open( fileName, O_RDONLY );
+		if ( fd < 0 )
+			return;
+
+		struct stat st = { };
+		if ( fstat( fd, &st ) == 0 && S_ISREG( st.st_mode ) && st.st_size > 0 )
+		{
+			void *data = mmap( nullptr, size_t( st.st_size ), PROT_READ, MAP_PRIVATE, fd, 0 );
+			if ( data != MAP_FAILED )
+			{
+				_data = data;
+				_size = size_t( st.st_size );
+
+#if defined( MADV_SEQUENTIAL )
+				madvise( _data, _size, MADV_SEQUENTIAL );
+#endif
+			}
+		}
+
+		close( fd );
+	}
+
+	~mapped_file()
+	{
+		if ( _data )
+			munmap( _data, _size );
+	}
+
+	mapped_file( const mapped_file & ) = delete;
+	mapped_file &operator=( const mapped_file & ) = delete;
+
+	explicit operator bool() const noexcept { return _data != nullptr; }
+	string_view view() const noexcept { return string_view( static_cast<const char *>( _data ), _size ); }
+
+private:
+	void *_data = nullptr;
+	size_t _size = 0;
+};
+
+} // namespace json5::detail
+#endif
+
 namespace json5 {
 
-// Write json5::document into file, returns 'true' on success
+//---------------------------------------------------------------------------------------------------------------------
+ostream_sink::ostream_sink( std::ostream &os ) noexcept
+	: _os( os )
+{}
+
+bool ostream_sink::flush( const char *data, size_t length ) {
+	_os.write( data, std::streamsize( length ) );
+	return bool( _os );
+}
+
+// Write json5::document into stream
+bool to_stream( std::ostream &os, const document &doc, const writer_params &wp ) {
+	ostream_sink sink( os );
+	return to_sink( sink, doc, wp );
+}
+
+// Write json5::document into file, the output is passed to 'write' in large blocks
 bool to_file( string_view fileName, const document &doc, const writer_params &wp ) {
-	std::ofstream ofs( string( fileName ).c_str() );
-	if ( !ofs.is_open() )
+	string name( fileName );
+
+#if defined( _JSON5_HAS_UNISTD )
+	int fd = open( name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+	if ( fd < 0 )
+		return false;
+
+	fd_sink sink( fd );
+	bool result = to_sink( sink, doc, wp );
+	return ( close( fd ) == 0 ) && result;
+#else
+	FILE *file = fopen( name.c_str(), "wb" );
+	if ( !file )
 		return false;
 
-	ofs << to_string( doc, wp );
-	return true;
+	file_sink sink( file );
+	bool result = to_sink( sink, doc, wp );
+	return ( fclose( file ) == 0 ) && result;
+#endif
+}
+
+// Parse json5::document from stream, the input is read and parsed in chunks
+error from_stream( std::istream &is, document &doc, const parser_params &pp ) {
+	parser r( doc, pp );
+	string chunk( 65536, 0 );
+
+	while ( is.read( chunk.data(), chunk.size() ) || is.gcount() )
+		if ( auto err = r.feed( chunk.data(), size_t( is.gcount() ) ) )
+			return err;
+
+	return r.finish();
 }
 
 // Parse json5::document from file
-error from_file( string_view fileName, document &doc ) {
-	std::ifstream ifs( string( fileName ).c_str() );
+error from_file( string_view fileName, document &doc, const parser_params &pp ) {
+	string name( fileName );
+
+#if defined( _JSON5_HAS_MMAP )
+	// Regular files are parsed directly from the mapped pages, strings are copied into the document
+	if ( detail::mapped_file file( name.c_str() ); file )
+		return from_string( file.view(), doc, pp );
+#endif
+
+	std::ifstream ifs( name.c_str() );
 	if ( !ifs.is_open() )
 		return { error::could_not_open };
 
-	auto str = string( std::istreambuf_iterator<char>( ifs ), std::istreambuf_iterator<char>() );
-	return from_string( string_view( str ), doc );
+	return from_stream( ifs, doc, pp );
 }
 
 
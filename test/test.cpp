@@ -7,6 +7,7 @@
 #include <chrono>
 #include <iostream>
 #include <map>
+#include <memory_resource>
 #include <type_traits>
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -83,6 +84,57 @@ int main( int argc, char *argv[] )
 		std::cout << json5::to_string( doc );
 	}
 
+	/// Build with known sizes
+	{
+		json5::document doc;
+		json5::builder b( doc );
+
+		// Children are written in place, adding more than announced is allowed
+		b.push_object( 2 );
+		{
+			b["name"] = b.new_string( "points" );
+
+			b.push_array( 3 );
+			{
+				b( 1.0, 2.0, 3.0, 4.0 );
+			}
+			b["values"] = b.pop();
+		}
+		b.pop();
+
+		std::cout << json5::to_string( doc );
+
+		// Unused reserved slots are given back, built with wrong counts or none, the documents are the same
+		auto build = []( json5::document &d, size_t objectCount, size_t arrayCount ) {
+			json5::builder b( d );
+			b.push_array( objectCount ? 2 : 0 );
+			{
+				b.push_object( objectCount );
+				{
+					b["a"] = 1.0;
+					b["b"] = 2.0;
+				}
+				b( b.pop() );
+
+				b.push_array( arrayCount );
+				{
+					b( 1.0, 2.0, 3.0, 4.0 );
+				}
+				b( b.pop() );
+			}
+			b.pop();
+		};
+
+		json5::document doc1, doc2;
+		build( doc1, 4, 3 );
+		build( doc2, 0, 0 );
+
+		if ( json5::to_string( doc1 ) == json5::to_string( doc2 ) && doc1.values_size() == doc2.values_size() )
+			std::cout << "doc1 == doc2, " << doc1.values_size() << " values" << std::endl;
+		else
+			std::cout << "doc1 != doc2, " << doc1.values_size() << " / " << doc2.values_size() << " values" << std::endl;
+	}
+
 	/// Load from file
 	{
 		json5::document doc;
@@ -197,5 +249,413 @@ int main( int argc, char *argv[] )
 		}
 	}
 
+	/// In place parsing
+	{
+		std::ifstream ifs( "twitter.json" );
+		std::string str( ( std::istreambuf_iterator<char>( ifs ) ), std::istreambuf_iterator<char>() );
+
+		json5::document doc1, doc2;
+		PrintError( json5::from_string( str, doc1 ) );
+		{
+			Stopwatch sw{ "Parse twitter.json in place" };
+			PrintError( json5::from_buffer( std::move( str ), doc2 ) );
+		}
+
+		if ( json5::to_string( doc1 ) == json5::to_string( doc2 ) )
+			std::cout << "doc1 == doc2" << std::endl;
+		else
+			std::cout << "doc1 != doc2" << std::endl;
+	}
+
+	/// Lazy numbers
+	{
+		json5::document doc;
+		json5::parser_params pp;
+		pp.lazy_numbers = true;
+
+		PrintError( json5::from_string( "{ pi: 3.14159265358979, big: 1.5e300, id: 505874924095815681 }", doc, pp ) );
+		std::cout << doc["pi"].get_number<double>() << " " << doc["id"].get_number<int64_t>() << std::endl;
+		std::cout << json5::to_string( doc );
+	}
+
+	/// Key interning
+	{
+		json5::document doc;
+		json5::parser_params pp;
+		pp.intern_keys = true;
+
+		PrintError( json5::from_string( "[ { id: 1, name: 'a' }, { id: 2, name: 'b' } ]", doc, pp ) );
+		std::cout << json5::to_string( doc );
+	}
+
+	/// Parsing events
+	{
+		// Sums all numbers without building a document
+		struct number_sum : json5::event_handler
+		{
+			double sum = 0.0;
+			bool on_number( double number ) override { sum += number; return true; }
+		};
+
+		std::ifstream ifs( "twitter.json" );
+		std::string str( ( std::istreambuf_iterator<char>( ifs ) ), std::istreambuf_iterator<char>() );
+
+		number_sum handler;
+		PrintError( json5::parse_events( str, handler ) );
+		std::cout << "Sum of numbers in twitter.json: " << handler.sum << std::endl;
+	}
+
+	/// Incremental parsing
+	{
+		std::ifstream ifs( "twitter.json" );
+		std::string str( ( std::istreambuf_iterator<char>( ifs ) ), std::istreambuf_iterator<char>() );
+
+		json5::document doc1, doc2;
+		PrintError( json5::from_string( str, doc1 ) );
+
+		// Feed input in small chunks, as if received from a socket
+		json5::parser p( doc2 );
+		for ( size_t i = 0; i < str.size(); i += 1000 )
+			PrintError( p.feed( std::string_view( str ).substr( i, 1000 ) ) );
+
+		PrintError( p.finish() );
+
+		if ( json5::to_string( doc1 ) == json5::to_string( doc2 ) )
+			std::cout << "doc1 == doc2" << std::endl;
+		else
+			std::cout << "doc1 != doc2" << std::endl;
+	}
+
+	/// Incremental parsing with interned keys split between chunks
+	{
+		json5::document doc;
+		json5::parser_params pp;
+		pp.intern_keys = true;
+
+		json5::parser p( doc, pp );
+		PrintError( p.feed( "{\"ab\"" ) );
+		PrintError( p.feed( ": 'zzzz', x: 1 }" ) );
+		PrintError( p.finish() );
+
+		std::cout << json5::to_string( doc );
+	}
+
+	/// Newline delimited records
+	{
+		std::string lines = "{ id: 1, name: 'a' }\n{ id: 2, name: }\n\n{ id: 3, name: 'c' } // comment\n{ id: 4 } { id: 5 }\n";
+
+		json5::document doc;
+		json5::parser p( doc, lines.data(), lines.size() );
+
+		json5::error err;
+		while ( p.parse_line( err ) )
+		{
+			if ( !PrintError( err ) )
+				std::cout << json5::to_string( doc );
+		}
+	}
+
+	/// Parallel records
+	{
+		std::string lines;
+		for ( int i = 0; i < 100000; ++i )
+			lines += "{ id: " + std::to_string( i ) + ", name: 'record', tags: [ 'a', 'b' ] }\n";
+
+		// Small chunks, so that every thread parses many of them
+		json5::parallel_params par;
+		par.threads = 4;
+		par.chunk_size = 64;
+
+		size_t sum = 0, nextId = 0;
+		bool inOrder = true;
+		auto stats = json5::parse_lines( lines, [&]( const json5::document &doc, const json5::error &err ) {
+			if ( !PrintError( err ) )
+			{
+				auto id = doc["id"].get_number<size_t>();
+				inOrder &= ( id == nextId++ );
+				sum += id;
+			}
+
+			return true;
+		}, json5::parser_params(), par );
+
+		std::cout << stats.records << " records on " << stats.threads << " threads, sum of ids: " << sum << ", "
+		          << stats.bytes_per_second() / 1000000.0 << " MB/s" << std::endl;
+
+		if ( inOrder && nextId == 100000 )
+			std::cout << "records in input order" << std::endl;
+		else
+			std::cout << "records out of order" << std::endl;
+	}
+
+	/// Parallel root array
+	{
+		std::string str = "[";
+		for ( int i = 0; i < 100000; ++i )
+		{
+			str += "{ id: " + std::to_string( i ) + ", name: 'record, [not] a {bracket}', tags: [ 'a', 'b' ], ";
+			str += "nested: { list: [ [ 1, '],' ], { key: \"\\\"],\" } ] } }, // item\n";
+		}
+
+		str += "]";
+
+		// Chunks much smaller than the input, so that elements are split across many chunks and threads
+		json5::document doc1, doc2;
+		json5::parallel_params par;
+		par.threads = 4;
+		par.chunk_size = 256;
+
+		PrintError( json5::from_string( str, doc1 ) );
+		{
+			Stopwatch sw{ "Parse root array in parallel" };
+			PrintError( json5::from_string_parallel( str, doc2, json5::parser_params(), par ) );
+		}
+
+		if ( json5::to_string( doc1 ) == json5::to_string( doc2 ) )
+			std::cout << "doc1 == doc2" << std::endl;
+		else
+			std::cout << "doc1 != doc2" << std::endl;
+	}
+
+	/// Arena allocation
+	{
+		std::ifstream ifs( "twitter.json" );
+		std::string str( ( std::istreambuf_iterator<char>( ifs ) ), std::istreambuf_iterator<char>() );
+
+		// All memory of the document is released at once with the arena
+		std::pmr::monotonic_buffer_resource arena( 1 << 20 );
+		{
+			Stopwatch sw{ "Parse twitter.json 10x (arena)" };
+
+			for ( int i = 0; i < 10; ++i )
+			{
+				{
+					json5::document doc( &arena );
+					PrintError( json5::from_string( str, doc ) );
+				}
+
+				arena.release();
+			}
+		}
+
+		// Integers stored between strings stay aligned after odd-sized allocations from the arena
+		for ( size_t skew = 1; skew < 8; ++skew )
+		{
+			arena.allocate( skew, 1 );
+
+			json5::document doc( &arena );
+			PrintError( json5::from_string( "{ a: '" + std::string( 22 + skew, 'x' ) + "', b: 505874924095815681 }", doc ) );
+
+			if ( doc["b"].get_number<uint64_t>() != 505874924095815681ull )
+				std::cout << "misaligned integer: " << json5::to_string( doc );
+		}
+	}
+
+	/// Document reuse
+	{
+		std::ifstream ifs( "twitter.json" );
+		std::string str( ( std::istreambuf_iterator<char>( ifs ) ), std::istreambuf_iterator<char>() );
+
+		json5::document doc;
+		json5::parser p( doc, str.data(), str.size() );
+		PrintError( p.parse() );
+		{
+			// Memory of the document and the parser is reused
+			Stopwatch sw{ "Parse twitter.json 10x (reused document)" };
+
+			for ( int i = 0; i < 10; ++i )
+			{
+				doc.clear();
+				PrintError( p.parse( str ) );
+			}
+		}
+	}
+
+	/// Number output
+	{
+		json5::document doc1;
+		PrintError( json5::from_string( "[ 0.1, 2.5e-8, 1.7976931348623157e308, -9007199254740993, "
+		                                "18446744073709551615, -9223372036854775808, NaN, -Infinity ]", doc1 ) );
+
+		// Shortest form, that parses back to the same numbers
+		auto str = json5::to_string( doc1 );
+		std::cout << str;
+
+		json5::document doc2;
+		PrintError( json5::from_string( str, doc2 ) );
+
+		if ( json5::to_string( doc2 ) == str )
+			std::cout << "doc1 == doc2" << std::endl;
+		else
+			std::cout << "doc1 != doc2" << std::endl;
+	}
+
+	/// String escaping
+	{
+		json5::document doc1;
+		PrintError( json5::from_string( "{ text: 'Tab\\t, quote \\\", emoji \\ud83d\\ude00, \u00e9' }", doc1 ) );
+
+		json5::writer_params wp;
+		wp.escape_unicode = true;
+
+		// Escaped output parses back to the same strings
+		auto str = json5::to_string( doc1, wp );
+		std::cout << str;
+
+		json5::document doc2;
+		PrintError( json5::from_string( str, doc2 ) );
+
+		if ( strcmp( doc1["text"].get_c_str(), doc2["text"].get_c_str() ) == 0 )
+			std::cout << "doc1 == doc2" << std::endl;
+		else
+			std::cout << "doc1 != doc2" << std::endl;
+	}
+
+	/// Value locations
+	{
+		json5::document doc;
+		json5::parser_params pp;
+		pp.track_locations = true;
+
+		PrintError( json5::from_string( "{\n  name: 'a',\n  items: [ 1, 2, 3 ]\n}", doc, pp ) );
+
+		// Values inside of the document and containers are located
+		for ( const auto &item : json5::array_view( doc["items"] ) )
+		{
+			auto loc = doc.loc( item );
+			std::cout << item.get_number<int>() << " at line " << loc.line << ", column " << loc.column << std::endl;
+		}
+
+		// Reflection errors are located too
+		json5::document barDoc;
+		PrintError( json5::from_string( "{\n  name: 10\n}", barDoc, pp ) );
+
+		BarBase bar;
+		PrintError( json5::from_document( barDoc, bar ) );
+	}
+
+	/// Document moves
+	{
+		std::ifstream ifs( "twitter.json" );
+		std::string str( ( std::istreambuf_iterator<char>( ifs ) ), std::istreambuf_iterator<char>() );
+
+		json5::document doc;
+		PrintError( json5::from_string( str, doc ) );
+
+		// Buffers are taken over, values keep pointing into them
+		std::vector<json5::document> docs;
+		for ( int i = 0; i < 10; ++i )
+			docs.push_back( doc );
+
+		json5::document moved = std::move( docs.back() );
+		if ( json5::to_string( moved ) == json5::to_string( doc ) )
+			std::cout << "moved == doc" << std::endl;
+		else
+			std::cout << "moved != doc" << std::endl;
+	}
+
+	/// Output sink
+	{
+		std::ifstream ifs( "twitter.json" );
+		std::string str( ( std::istreambuf_iterator<char>( ifs ) ), std::istreambuf_iterator<char>() );
+
+		json5::document doc;
+		PrintError( json5::from_string( str, doc ) );
+
+		// Output is received in pieces of up to 64 KiB
+		size_t pieces = 0, bytes = 0;
+		json5::callback_sink sink( [&]( const char *data, size_t length ) {
+			++pieces;
+			bytes += length;
+			return true;
+		} );
+
+		if ( json5::to_sink( sink, doc ) && bytes == json5::to_string( doc ).size() )
+			std::cout << "sink: " << bytes << " bytes in " << pieces << " pieces" << std::endl;
+
+		json5::document loaded;
+		if ( json5::to_file( "twitter_out.json5", doc ) && !json5::from_file( "twitter_out.json5", loaded ) &&
+			json5::to_string( loaded ) == json5::to_string( doc ) )
+			std::cout << "to_file == doc" << std::endl;
+	}
+
+	/// Pretty printing
+	{
+		std::ifstream ifs( "twitter.json" );
+		std::string str( ( std::istreambuf_iterator<char>( ifs ) ), std::istreambuf_iterator<char>() );
+
+		json5::document doc;
+		PrintError( json5::from_string( str, doc ) );
+
+		for ( bool compact : { false, true } )
+		{
+			json5::writer_params wp;
+			wp.compact = compact;
+
+			Stopwatch sw{ compact ? "Write twitter.json 10x (compact)" : "Write twitter.json 10x (pretty)" };
+
+			for ( int i = 0; i < 10; ++i )
+				json5::to_string( doc, wp );
+		}
+
+		// Compact output pads containers up to compact_array_size / compact_object_size items, nested ones too
+		json5::document small;
+		PrintError( json5::from_string( "{ a: { x: 1 }, b: [ 1, 2 ], c: [ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 ], d: {} }", small ) );
+
+		json5::writer_params wp;
+		wp.compact = true;
+
+		if ( json5::to_string( small, wp ) == "{a:{ x:1 },b:[ 1, 2 ],c:[1,2,3,4,5,6,7,8,9,10,11,12],d:{}}" )
+			std::cout << "compact padding kept" << std::endl;
+		else
+			std::cout << "compact padding changed: " << json5::to_string( small, wp ) << std::endl;
+	}
+
+	/// Output into fixed buffer
+	{
+		json5::document doc;
+		PrintError( json5::from_string( "{ name: 'slot', values: [ 1, 2.5, true, null ] }", doc ) );
+
+		// Buffer of exact size, one character less does not fit
+		std::vector<char> buffer( json5::measure( doc ) );
+
+		if ( size_t size = json5::to_buffer( buffer.data(), buffer.size(), doc ) )
+			std::cout << std::string( buffer.data(), size );
+
+		if ( !json5::to_buffer( buffer.data(), buffer.size() - 1, doc ) )
+			std::cout << "does not fit into " << buffer.size() - 1 << " characters" << std::endl;
+	}
+
+	/// Parser backends A/B
+	for ( const char *fileName : { "twitter.json", "twitter.json5" } )
+	{
+		std::ifstream ifs( fileName );
+		std::string str( ( std::istreambuf_iterator<char>( ifs ) ), std::istreambuf_iterator<char>() );
+
+		json5::document doc1, doc2;
+		json5::parser_params pp;
+
+		std::cout << fileName << std::endl;
+		{
+			Stopwatch sw{ "Parse 10x (recursive)" };
+
+			for ( int i = 0; i < 10; ++i )
+				PrintError( json5::from_string( str, doc1, pp ) );
+		}
+
+		pp.backend = json5::parser_backend::structural_index;
+		{
+			Stopwatch sw{ "Parse 10x (structural index)" };
+
+			for ( int i = 0; i < 10; ++i )
+				PrintError( json5::from_string( str, doc2, pp ) );
+		}
+
+		if ( json5::to_string( doc1 ) == json5::to_string( doc2 ) )
+			std::cout << "doc1 == doc2" << std::endl;
+		else
+			std::cout << "doc1 != doc2" << std::endl;
+	}
+
 	return 0;
 }